@@ -22,6 +22,7 @@ class HeraldConan(ConanFile):
 
     def package(self):
         self.copy("*.h", dst="include", src="herald/include")
+        self.copy("*.hpp", dst="include", src="herald/include")
         self.copy("*.lib", dst="lib", keep_path=False)
         self.copy("*.dll", dst="bin", keep_path=False)
         self.copy("*.dylib*", dst="lib", keep_path=False)
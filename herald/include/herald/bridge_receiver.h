@@ -0,0 +1,86 @@
+#pragma once
+
+/// \addtogroup API
+/// @{
+
+#include <stdlib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  /// Return code for bridge receiver functions.
+  enum bridge_receiver_error {
+    /// Operation was successful.
+    BRIDGE_RECEIVER_OK = 0,
+
+    /// Could not create and connect socket to the bridge sender.
+    BRIDGE_RECEIVER_NOSOCKET,
+
+    /// Bad response from bridge sender, aborted.
+    BRIDGE_RECEIVER_BADRESP,
+
+    /// Could not initialize the local publisher.
+    BRIDGE_RECEIVER_NOPUBLISHER
+  };
+
+  struct bridge_receiver_t;
+
+  /// Counters of a bridge receiver.
+  struct bridge_receiver_stats_t {
+    /// Messages received and republished locally.
+    unsigned long messages;
+
+    /// Number of discontinuities in the sequence numbers received, checked within each lane.
+    unsigned long gaps;
+
+    /// Total number of messages missing from the sequence numbers received.
+    unsigned long lost;
+
+    /// Number of times the sequence numbers went backwards, e.g. because the remote publisher
+    /// restarted. Counting starts again from the new sequence number.
+    unsigned long resyncs;
+
+    /// Non-zero while connected to the bridge sender. Becomes zero once the sender disconnects
+    /// or sends a corrupt frame; the receiver does not reconnect, destroy and recreate it.
+    int connected;
+  };
+
+  /// Create a bridge receiver, which connects to a remote \ref bridge_sender_t and
+  /// republishes its messages through a local publisher, so local subscribers can use the
+  /// regular API. Does not connect until \ref bridge_receiver_init is called.
+  ///
+  /// NOTE: should not be freed, use \ref bridge_receiver_destroy to shutdown and cleanup the
+  /// bridge receiver.
+  ///
+  /// \param host the IPv4 address of the bridge sender.
+  /// \param bridge_port the tcp port the bridge sender is listening on.
+  /// \param publish_port the port of the local publisher to republish messages on.
+  /// \return an uninitialized bridge receiver handle.
+  bridge_receiver_t *bridge_receiver_create(
+    const char *host, const int bridge_port, const int publish_port);
+
+  /// Destroy a bridge receiver. If it was initialized, it will close the connection to the
+  /// bridge sender and destroy the local publisher.
+  ///
+  /// \param receiver the bridge receiver handle to destroy.
+  void bridge_receiver_destroy(bridge_receiver_t *receiver);
+
+  /// Initialize a bridge receiver. This will connect to the bridge sender and start the
+  /// local publisher with the sender's buffer size.
+  ///
+  /// \param receiver the bridge receiver handle to initialize.
+  /// \return BRIDGE_RECEIVER_OK if initialization was successful or an errorcode if not.
+  bridge_receiver_error bridge_receiver_init(bridge_receiver_t *receiver);
+
+  /// Read the counters of a bridge receiver.
+  ///
+  /// \param receiver the bridge receiver to read.
+  /// \param stats set to the current counters.
+  void bridge_receiver_get_stats(bridge_receiver_t *receiver, bridge_receiver_stats_t *stats);
+
+#ifdef __cplusplus
+} //end extern "C"
+#endif
+
+/// @}
@@ -0,0 +1,86 @@
+#pragma once
+
+/// \addtogroup API
+/// @{
+
+#include <stdlib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  struct bridge_sender_t;
+
+  /// Return code for bridge sender functions.
+  enum bridge_sender_error {
+    /// Operation was successful.
+    BRIDGE_SENDER_OK = 0,
+
+    /// Could not create and bind to the socket.
+    BRIDGE_SENDER_NOSOCKET,
+
+    /// Could not subscribe to the local publisher.
+    BRIDGE_SENDER_NOSUBSCRIBER
+  };
+
+  /// Counters of a bridge sender.
+  struct bridge_sender_stats_t {
+    /// Messages forwarded to remote bridge receivers; messages sent while none is connected
+    /// are not counted.
+    unsigned long messages;
+
+    /// Batches queued to at least one receiver, each written with as few writes as the sockets allow.
+    unsigned long batches;
+
+    /// Messages dropped because the pending batch was full.
+    unsigned long dropped;
+
+    /// Receivers disconnected because they fell too far behind or their connection failed.
+    unsigned long disconnected;
+  };
+
+  /// Create a bridge sender, which subscribes to a local publisher and streams its messages
+  /// over tcp to every connected \ref bridge_receiver_t. Does not subscribe or listen until
+  /// \ref bridge_sender_init is called.
+  ///
+  /// Messages arriving while a batch is being written are appended to the next batch, so
+  /// writes grow under load. Messages that don't fit in a full batch are dropped and show up
+  /// as sequence gaps on the receivers.
+  ///
+  /// Writes never block: each receiver has its own backlog of unsent bytes, and a receiver
+  /// whose backlog would exceed a few batches is disconnected instead of holding up the rest.
+  ///
+  /// NOTE: should not be freed, use \ref bridge_sender_destroy to shutdown and cleanup the
+  /// bridge sender.
+  ///
+  /// \param local_port the tcp port of the local publisher to forward.
+  /// \param bridge_port the port to bind the server which accepts bridge receivers.
+  /// \param max_batch_bytes the maximum size of a single batch write.
+  /// \return an uninitialized bridge sender handle.
+  bridge_sender_t *bridge_sender_create(
+    const int local_port, const int bridge_port, const size_t max_batch_bytes);
+
+  /// Destroy a bridge sender. If it was initialized, it will disconnect all bridge receivers
+  /// and unsubscribe from the local publisher.
+  ///
+  /// \param sender the bridge sender handle to destroy.
+  void bridge_sender_destroy(bridge_sender_t *sender);
+
+  /// Initialize a bridge sender. This will subscribe to the local publisher, bind to the
+  /// bridge port and start accepting bridge receivers.
+  ///
+  /// \param sender the bridge sender to initialize.
+  /// \return BRIDGE_SENDER_OK if initialization was successful or an errcode if not.
+  bridge_sender_error bridge_sender_init(bridge_sender_t *sender);
+
+  /// Read the counters of a bridge sender.
+  ///
+  /// \param sender the bridge sender to read.
+  /// \param stats set to the current counters.
+  void bridge_sender_get_stats(bridge_sender_t *sender, bridge_sender_stats_t *stats);
+
+#ifdef __cplusplus
+} //end extern "C"
+#endif
+
+/// @}
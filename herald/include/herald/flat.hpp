@@ -0,0 +1,425 @@
+#pragma once
+
+/// \addtogroup CXX
+/// @{
+
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <type_traits>
+
+#include "publisher.h"
+
+/// Offset-based flat message format, built in place and read without decoding.
+///
+/// Layout of a message, in host byte order:
+///   - a uint32 offset from the start of the message to the root table,
+///   - strings: uint32 length, the bytes, a terminating NUL,
+///   - vectors: uint32 count, then the elements at their natural alignment,
+///   - tables: an int32 offset to the table's vtable, then the inline fields,
+///   - vtables: uint16 vtable size, uint16 table size, then one uint16 offset per field id
+///     (0 if the field is absent).
+/// Strings, vectors and nested tables are referenced from table fields by an int32 offset
+/// relative to the field.
+///
+/// Schema evolution: fields are identified by id. New fields get new ids; readers get the
+/// default for ids missing from an older message's vtable and never look at ids they don't
+/// know about.
+namespace herald {
+namespace flat {
+
+  typedef uint32_t uoffset_t;
+  typedef int32_t soffset_t;
+  typedef uint16_t voffset_t;
+
+  namespace detail {
+    template <typename T>
+    inline T read(const uint8_t *p) {
+      T value;
+      memcpy(&value, p, sizeof(T));
+      return value;
+    }
+
+    template <typename T>
+    inline void write(uint8_t *p, const T value) {
+      memcpy(p, &value, sizeof(T));
+    }
+
+    inline const uint8_t *follow(const uint8_t *p) {
+      return p + read<soffset_t>(p);
+    }
+  } // namespace detail
+
+  /// A string, vector or table already written by a \ref Builder.
+  struct Ref {
+    uoffset_t pos;
+  };
+
+  /// Writes a flat message into a caller-provided buffer, front to back.
+  ///
+  /// Strings, vectors and nested tables must be created before the table that refers to
+  /// them, and only one table can be under construction at a time. Any misuse or running
+  /// out of space makes \ref finish return 0.
+  class Builder {
+  public:
+    /// Maximum number of field ids in a table.
+    static const voffset_t kMaxFields = 64;
+
+    /// \param buffer where the message is written, aligned to at least 8 bytes.
+    /// \param capacity the size of \p buffer.
+    Builder(void *buffer, const size_t capacity)
+      : _buf(static_cast<uint8_t*>(buffer))
+      , _capacity(buffer != nullptr ? capacity : 0)
+      , _size(sizeof(uoffset_t))
+      , _ok(_capacity >= sizeof(uoffset_t))
+      , _table_start(0)
+      , _num_fields(0) {}
+
+    Ref create_string(const char *str, const size_t length) {
+      uint8_t *p = open_object(sizeof(uoffset_t) + length + 1, alignof(uoffset_t));
+      if (p == nullptr) {
+        return Ref{0};
+      }
+
+      detail::write<uoffset_t>(p, length);
+      memcpy(p + sizeof(uoffset_t), str, length);
+      p[sizeof(uoffset_t) + length] = 0;
+      return Ref{static_cast<uoffset_t>(p - _buf)};
+    }
+
+    Ref create_string(const std::string &str) {
+      return create_string(str.data(), str.size());
+    }
+
+    /// Reserve a vector of \p count elements and return a pointer to fill them in place.
+    template <typename T>
+    T *create_uninitialized_vector(const size_t count, Ref *ref) {
+      static_assert(std::is_trivially_copyable<T>::value,
+                    "herald::flat vector elements must be trivially copyable");
+
+      // Pad so the elements, not the count, land on T's alignment.
+      const size_t align = alignof(T) > alignof(uoffset_t) ? alignof(T) : alignof(uoffset_t);
+      const size_t elements = align_up(_size + sizeof(uoffset_t), align);
+      uint8_t *p = open_object(elements - _size + count * sizeof(T), 1);
+      if (p == nullptr) {
+        *ref = Ref{0};
+        return nullptr;
+      }
+
+      uint8_t *count_pos = _buf + elements - sizeof(uoffset_t);
+      memset(p, 0, count_pos - p);
+      detail::write<uoffset_t>(count_pos, count);
+      *ref = Ref{static_cast<uoffset_t>(count_pos - _buf)};
+      return reinterpret_cast<T*>(_buf + elements);
+    }
+
+    template <typename T>
+    Ref create_vector(const T *data, const size_t count) {
+      Ref ref;
+      T *elements = create_uninitialized_vector<T>(count, &ref);
+      if (elements != nullptr) {
+        memcpy(elements, data, count * sizeof(T));
+      }
+      return ref;
+    }
+
+    /// Start a table with field ids in [0, num_fields).
+    void start_table(const voffset_t num_fields) {
+      if (_table_start != 0 || num_fields > kMaxFields) {
+        _ok = false;
+        return;
+      }
+
+      uint8_t *p = alloc(sizeof(soffset_t), 8);
+      if (p == nullptr) {
+        return;
+      }
+
+      _table_start = p - _buf;
+      _num_fields = num_fields;
+      memset(_field_offsets, 0, sizeof(_field_offsets));
+    }
+
+    /// Add a scalar or trivially copyable struct field to the open table.
+    template <typename T>
+    void add(const voffset_t field, const T value) {
+      static_assert(std::is_trivially_copyable<T>::value,
+                    "herald::flat inline fields must be trivially copyable");
+
+      uint8_t *p = open_field(field, sizeof(T), alignof(T));
+      if (p != nullptr) {
+        detail::write<T>(p, value);
+      }
+    }
+
+    /// Add a reference to a string, vector or table to the open table. Null refs are skipped.
+    void add(const voffset_t field, const Ref ref) {
+      if (ref.pos == 0) {
+        return;
+      }
+
+      uint8_t *p = open_field(field, sizeof(soffset_t), alignof(soffset_t));
+      if (p != nullptr) {
+        detail::write<soffset_t>(p, static_cast<soffset_t>(ref.pos - (p - _buf)));
+      }
+    }
+
+    /// Close the open table by writing its vtable.
+    Ref end_table() {
+      if (_table_start == 0) {
+        _ok = false;
+        return Ref{0};
+      }
+
+      const size_t table_size = _size - _table_start;
+      const size_t vtable_size = 2 * sizeof(voffset_t) + _num_fields * sizeof(voffset_t);
+      uint8_t *vtable = alloc(vtable_size, alignof(voffset_t));
+      const uoffset_t table_start = _table_start;
+      _table_start = 0;
+
+      if (vtable == nullptr || table_size > 0xffff) {
+        _ok = false;
+        return Ref{0};
+      }
+
+      detail::write<voffset_t>(vtable, vtable_size);
+      detail::write<voffset_t>(vtable + sizeof(voffset_t), table_size);
+      memcpy(vtable + 2 * sizeof(voffset_t), _field_offsets, _num_fields * sizeof(voffset_t));
+      detail::write<soffset_t>(
+        _buf + table_start, static_cast<soffset_t>((vtable - _buf) - table_start));
+      return Ref{table_start};
+    }
+
+    /// Set \p root as the message's root table.
+    ///
+    /// \return the size of the message, or 0 if it could not be built.
+    size_t finish(const Ref root) {
+      if (!_ok || _table_start != 0 || root.pos == 0) {
+        return 0;
+      }
+
+      detail::write<uoffset_t>(_buf, root.pos);
+      return _size;
+    }
+
+  private:
+    static size_t align_up(const size_t pos, const size_t align) {
+      return (pos + align - 1) & ~(align - 1);
+    }
+
+    uint8_t *alloc(const size_t size, const size_t align) {
+      const size_t pos = align_up(_size, align);
+      if (!_ok || pos + size > _capacity) {
+        _ok = false;
+        return nullptr;
+      }
+
+      memset(_buf + _size, 0, pos - _size);
+      _size = pos + size;
+      return _buf + pos;
+    }
+
+    uint8_t *open_object(const size_t size, const size_t align) {
+      if (_table_start != 0) {
+        _ok = false;
+        return nullptr;
+      }
+      return alloc(size, align);
+    }
+
+    uint8_t *open_field(const voffset_t field, const size_t size, const size_t align) {
+      if (_table_start == 0 || field >= _num_fields) {
+        _ok = false;
+        return nullptr;
+      }
+
+      uint8_t *p = alloc(size, align);
+      if (p != nullptr) {
+        _field_offsets[field] = static_cast<voffset_t>((p - _buf) - _table_start);
+      }
+      return p;
+    }
+
+    uint8_t *_buf;
+    size_t _capacity;
+    size_t _size;
+    bool _ok;
+
+    // Table under construction, 0 if none.
+    uoffset_t _table_start;
+    voffset_t _num_fields;
+    voffset_t _field_offsets[kMaxFields];
+  };
+
+  /// Builds a flat message directly in a buffer loaned from a publisher, see
+  /// \ref publisher_loan. The loan is given back if the message is never published.
+  ///
+  /// This is not zero-copy: the loan is a heap buffer owned by the publisher, so building in it
+  /// only avoids a separate buffer on the caller's side. The publisher still copies the finished
+  /// message into each matching subscriber's shared memory.
+  ///
+  /// NOTE: must not outlive the publisher, whose loan it gives back when destroyed.
+  class LoanBuilder : public Builder {
+  public:
+    explicit LoanBuilder(publisher_t *publisher)
+      : LoanBuilder(publisher, publisher_loan(publisher)) {}
+
+    ~LoanBuilder() {
+      if (_loan != nullptr) {
+        publisher_return_loan(_publisher, _loan);
+      }
+    }
+
+    LoanBuilder(const LoanBuilder&) = delete;
+    LoanBuilder &operator=(const LoanBuilder&) = delete;
+
+    /// Finish the message with \p root and publish it on priority lane \p lane to the
+    /// subscribers matching \p tag. If the message could not be built the loan is kept
+    /// until the builder is destroyed.
+    publisher_error publish(
+        const Ref root, const unsigned long tag = PUB_TAG_ALL, const int lane = 0) {
+      if (_loan == nullptr) {
+        return PUB_NOLOAN;
+      }
+
+      const size_t length = finish(root);
+      if (length == 0) {
+        return PUB_TOOLARGE;
+      }
+
+      void *loan = _loan;
+      _loan = nullptr;
+      return publisher_publish_loan_lane(_publisher, loan, length, tag, lane);
+    }
+
+  private:
+    LoanBuilder(publisher_t *publisher, void *loan)
+      : Builder(loan, publisher_buffer_size(publisher))
+      , _publisher(publisher)
+      , _loan(loan) {}
+
+    publisher_t *_publisher;
+    void *_loan;
+  };
+
+  /// A string in a flat message.
+  class String {
+  public:
+    String() : _p(nullptr) {}
+    explicit String(const uint8_t *p) : _p(p) {}
+
+    /// NUL terminated.
+    const char *c_str() const {
+      return _p != nullptr ? reinterpret_cast<const char*>(_p + sizeof(uoffset_t)) : "";
+    }
+
+    size_t size() const {
+      return _p != nullptr ? detail::read<uoffset_t>(_p) : 0;
+    }
+
+    std::string str() const {
+      return std::string(c_str(), size());
+    }
+
+  private:
+    const uint8_t *_p;
+  };
+
+  /// A vector of trivially copyable elements in a flat message.
+  template <typename T>
+  class Vector {
+  public:
+    Vector() : _p(nullptr) {}
+    explicit Vector(const uint8_t *p) : _p(p) {}
+
+    size_t size() const {
+      return _p != nullptr ? detail::read<uoffset_t>(_p) : 0;
+    }
+
+    const T *data() const {
+      return _p != nullptr ? reinterpret_cast<const T*>(_p + sizeof(uoffset_t)) : nullptr;
+    }
+
+    const T &operator[](const size_t i) const {
+      return data()[i];
+    }
+
+    const T *begin() const {
+      return data();
+    }
+
+    const T *end() const {
+      return data() + size();
+    }
+
+  private:
+    const uint8_t *_p;
+  };
+
+  /// A table in a flat message. Accessors return the default for absent fields.
+  class Table {
+  public:
+    Table() : _p(nullptr) {}
+    explicit Table(const uint8_t *p) : _p(p) {}
+
+    bool valid() const {
+      return _p != nullptr;
+    }
+
+    bool has(const voffset_t field) const {
+      return field_ptr(field) != nullptr;
+    }
+
+    template <typename T>
+    T get(const voffset_t field, const T default_value) const {
+      const uint8_t *p = field_ptr(field);
+      return p != nullptr ? detail::read<T>(p) : default_value;
+    }
+
+    String get_string(const voffset_t field) const {
+      const uint8_t *p = field_ptr(field);
+      return p != nullptr ? String(detail::follow(p)) : String();
+    }
+
+    template <typename T>
+    Vector<T> get_vector(const voffset_t field) const {
+      const uint8_t *p = field_ptr(field);
+      return p != nullptr ? Vector<T>(detail::follow(p)) : Vector<T>();
+    }
+
+    Table get_table(const voffset_t field) const {
+      const uint8_t *p = field_ptr(field);
+      return p != nullptr ? Table(detail::follow(p)) : Table();
+    }
+
+  private:
+    const uint8_t *field_ptr(const voffset_t field) const {
+      if (_p == nullptr) {
+        return nullptr;
+      }
+
+      const uint8_t *vtable = detail::follow(_p);
+      const size_t entry = 2 * sizeof(voffset_t) + field * sizeof(voffset_t);
+      if (entry + sizeof(voffset_t) > detail::read<voffset_t>(vtable)) {
+        return nullptr;
+      }
+
+      const voffset_t offset = detail::read<voffset_t>(vtable + entry);
+      return offset != 0 ? _p + offset : nullptr;
+    }
+
+    const uint8_t *_p;
+  };
+
+  /// The root table of a flat message, e.g. the data passed to a \ref callback_t.
+  ///
+  /// NOTE: the message is not validated, it must come from a trusted \ref Builder.
+  inline Table root(const void *data) {
+    const uint8_t *p = static_cast<const uint8_t*>(data);
+    return Table(p + detail::read<uoffset_t>(p));
+  }
+
+} // namespace flat
+} // namespace herald
+
+/// @}
@@ -47,11 +47,43 @@ int main(int argc, char **argv) {
 }
 \endcode
 
+## RPC example (no error checking):
+
+\code{.cpp}
+#include <string.h>
+
+#include <herald/herald.h>
+
+int main(int argc, char **argv) {
+  rpc_server_t *server = rpc_server_create(8081, 1024,
+    [](const void *req, size_t req_len, void *reply, size_t reply_capacity) -> size_t {
+      memcpy(reply, req, req_len);
+      return req_len;
+    });
+  rpc_server_init(server);
+
+  rpc_client_t *client = rpc_client_create(8081);
+  rpc_client_init(client);
+
+  char reply[1024];
+  size_t reply_len;
+  rpc_client_call(client, "ping", 4, reply, sizeof(reply), &reply_len, 100);
+}
+\endcode
+
 **/
 
 /// \defgroup API
-/// This is the low level API which provides the publisher and subscriber interfaces.
+/// This is the low level API which provides the publisher and subscriber interfaces, the
+/// request/reply rpc server and client interfaces, and the bridge which relays channels
+/// between hosts.
 
 #pragma once
 #include "subscriber.h"
 #include "publisher.h"
+#include "rpc_server.h"
+#include "rpc_client.h"
+#include "bridge_sender.h"
+#include "bridge_receiver.h"
+#include "thread_attr.h"
+#include "trace.h"
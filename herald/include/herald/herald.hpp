@@ -0,0 +1,196 @@
+#pragma once
+
+/// \defgroup CXX
+/// Header-only typed C++ layer over the \ref API for fixed-layout messages.
+/// @{
+
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "herald.h"
+#include "flat.hpp"
+
+namespace herald {
+
+  /// Publishes messages of the trivially copyable type \p T.
+  ///
+  /// The publisher's buffer size is sizeof(T), and messages are constructed in place in a
+  /// buffer loaned from the publisher, see \ref publisher_loan.
+  template <typename T>
+  class Publisher {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "herald::Publisher messages must be trivially copyable");
+    static_assert(alignof(T) <= PUB_SLOT_ALIGN,
+                  "herald::Publisher messages must not be over-aligned");
+
+  public:
+    /// \param port the port to bind the server which accepts subscriber connections.
+    explicit Publisher(const int port)
+      : _publisher(publisher_create(port, sizeof(T))) {}
+
+    /// \param port the port to bind the server which accepts subscriber connections.
+    /// \param attr the attributes of the publisher's threads.
+    Publisher(const int port, const publisher_attr_t &attr)
+      : _publisher(publisher_create_with_attr(port, sizeof(T), &attr)) {}
+
+    ~Publisher() {
+      publisher_destroy(_publisher);
+    }
+
+    Publisher(const Publisher&) = delete;
+    Publisher &operator=(const Publisher&) = delete;
+
+    /// See \ref publisher_init.
+    publisher_error init() {
+      return publisher_init(_publisher);
+    }
+
+    /// Construct a message from \p args in place and publish it to all subscribers.
+    template <typename... Args>
+    publisher_error emplace(Args&&... args) {
+      return emplace_tagged(PUB_TAG_ALL, std::forward<Args>(args)...);
+    }
+
+    /// Construct a message from \p args in place and publish it to the subscribers whose
+    /// filter matches \p tag.
+    template <typename... Args>
+    publisher_error emplace_tagged(const unsigned long tag, Args&&... args) {
+      return emplace_lane(0, tag, std::forward<Args>(args)...);
+    }
+
+    /// Construct a message from \p args in place and publish it on priority lane \p lane
+    /// to the subscribers whose filter matches \p tag, see \ref publisher_publish_lane.
+    ///
+    /// \p T is constructed with `T(args...)` if it has a matching constructor, else with
+    /// `T{args...}`, so aggregates can be built from their members. If construction throws,
+    /// the loan is given back and the exception propagates.
+    template <typename... Args>
+    publisher_error emplace_lane(const int lane, const unsigned long tag, Args&&... args) {
+      void *loan = publisher_loan(_publisher);
+      if (loan == nullptr) {
+        return PUB_NOLOAN;
+      }
+
+      try {
+        construct(loan, std::is_constructible<T, Args&&...>(), std::forward<Args>(args)...);
+      } catch (...) {
+        publisher_return_loan(_publisher, loan);
+        throw;
+      }
+
+      return publisher_publish_loan_lane(_publisher, loan, sizeof(T), tag, lane);
+    }
+
+    /// Publish a copy of \p msg to all subscribers.
+    publisher_error publish(const T &msg) {
+      return emplace(msg);
+    }
+
+    /// The underlying C handle.
+    publisher_t *handle() {
+      return _publisher;
+    }
+
+  private:
+    template <typename... Args>
+    static void construct(void *loan, std::true_type, Args&&... args) {
+      new (loan) T(std::forward<Args>(args)...);
+    }
+
+    template <typename... Args>
+    static void construct(void *loan, std::false_type, Args&&... args) {
+      new (loan) T{std::forward<Args>(args)...};
+    }
+
+    publisher_t *_publisher;
+  };
+
+  /// Subscribes to messages of the trivially copyable type \p T.
+  ///
+  /// The callback can be any callable, including capturing lambdas, taking either
+  /// `(const T&)` or `(const T&, const message_info_t&)`. It is handed a reference pointing
+  /// directly into the shared memory segment, which is only valid for the duration of the call.
+  ///
+  /// NOTE: the publisher must publish the same \p T; \ref init fails with SUB_BADRESP if the
+  /// publisher's buffer size is not sizeof(T), so no per-message length check is needed.
+  template <typename T>
+  class Subscriber {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "herald::Subscriber messages must be trivially copyable");
+    static_assert(alignof(T) <= PUB_SLOT_ALIGN,
+                  "herald::Subscriber messages must not be over-aligned");
+
+  public:
+    using Callback = std::function<void(const T&, const message_info_t&)>;
+
+    /// \param port the tcp port the publisher is running on.
+    /// \param callback called with each message.
+    template <typename F>
+    Subscriber(const int port, F &&callback)
+      : Subscriber(port, std::forward<F>(callback), default_attr()) {}
+
+    /// \param port the tcp port the publisher is running on.
+    /// \param callback called with each message.
+    /// \param attr the subscriber attributes, e.g. its thread and tag filter.
+    template <typename F>
+    Subscriber(const int port, F &&callback, subscriber_attr_t attr)
+      : _callback(wrap(std::forward<F>(callback), 0)) {
+      attr.expected_buffer_size = sizeof(T);
+      _subscriber = subscriber_create_ctx(port, &Subscriber::dispatch, this, &attr);
+    }
+
+    ~Subscriber() {
+      subscriber_destroy(_subscriber);
+    }
+
+    Subscriber(const Subscriber&) = delete;
+    Subscriber &operator=(const Subscriber&) = delete;
+
+    /// See \ref subscriber_init.
+    subscriber_error init() {
+      return subscriber_init(_subscriber);
+    }
+
+    /// See \ref subscriber_set_filter.
+    void set_filter(const unsigned long filter) {
+      subscriber_set_filter(_subscriber, filter);
+    }
+
+    /// The underlying C handle.
+    subscriber_t *handle() {
+      return _subscriber;
+    }
+
+  private:
+    static subscriber_attr_t default_attr() {
+      subscriber_attr_t attr;
+      subscriber_attr_init(&attr);
+      return attr;
+    }
+
+    template <typename F>
+    static auto wrap(F &&callback, int)
+      -> decltype(callback(std::declval<const T&>(), std::declval<const message_info_t&>()),
+                  Callback()) {
+      return Callback(std::forward<F>(callback));
+    }
+
+    template <typename F>
+    static Callback wrap(F &&callback, long) {
+      return [callback](const T &msg, const message_info_t&) { callback(msg); };
+    }
+
+    static void dispatch(const void *data, size_t, const message_info_t *info, void *ctx) {
+      Subscriber *self = static_cast<Subscriber*>(ctx);
+      self->_callback(*static_cast<const T*>(data), *info);
+    }
+
+    Callback _callback;
+    subscriber_t *_subscriber;
+  };
+
+} // namespace herald
+
+/// @}
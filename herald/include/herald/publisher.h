@@ -5,12 +5,23 @@
 
 #include <stdlib.h>
 
+#include "thread_attr.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
   struct publisher_t;
 
+  /// Tag matching every subscriber filter, used by \ref publisher_publish.
+#define PUB_TAG_ALL (~0UL)
+
+  /// Alignment of loaned buffers and of message slots in shared memory.
+#define PUB_SLOT_ALIGN 64
+
+  /// Maximum number of priority lanes of a publisher, see \ref publisher_attr_t.
+#define PUB_MAX_LANES 4
+
   /// Return code for publisher functions.
   enum publisher_error {
     /// Operation was successful.
@@ -23,9 +34,37 @@ extern "C" {
     PUB_TOOLARGE,
 
     /// Attempted to publish message on unititialized publisher.
-    PUB_NOTRUNNING
+    PUB_NOTRUNNING,
+
+    /// Could not apply the thread attributes to the publisher's threads.
+    PUB_NOTHREADATTR,
+
+    /// Priority lane out of range.
+    PUB_BADLANE,
+
+    /// Could not allocate a loaned buffer, see \ref publisher_loan.
+    PUB_NOLOAN
+  };
+
+  /// Attributes of the publisher.
+  struct publisher_attr_t {
+    /// The thread accepting subscriber connections.
+    herald_thread_attr_t server_thread;
+
+    /// The thread writing messages to subscribers.
+    herald_thread_attr_t publish_thread;
+
+    /// Number of priority lanes, from 1 to \ref PUB_MAX_LANES. Each lane has its own queue
+    /// and its own slots in every subscriber's shared memory region, so messages on a higher
+    /// lane are never held up or overwritten by messages on a lower one.
+    int num_lanes;
   };
 
+  /// Reset \p attr to the defaults, which leave all threads unchanged and use a single lane.
+  ///
+  /// \param attr the publisher attributes to reset.
+  void publisher_attr_init(publisher_attr_t *attr);
+
   /// Create a publisher. Does not initialize server until \ref publisher_init is called.
   ///
   /// NOTE: should not be freed, use \ref publisher_destroy to shutdown and cleanup the
@@ -36,6 +75,16 @@ extern "C" {
   /// \return an uninitialized publisher handle.
   publisher_t *publisher_create(const int port, const size_t buffer_size);
 
+  /// Create a publisher whose internal threads are configured by \p attr when
+  /// \ref publisher_init starts them.
+  ///
+  /// \param port the port to bind the server which accepts subscriber connections.
+  /// \param buffer_size the maximum allowed size of messages to be published.
+  /// \param attr the publisher attributes copied by this call, or NULL for the defaults.
+  /// \return an uninitialized publisher handle.
+  publisher_t *publisher_create_with_attr(
+    const int port, const size_t buffer_size, const publisher_attr_t *attr);
+
   /// Destroy a publisher. If it was initialized, it will close server connection and disconnect
   /// all connected clients as well as destroying all shared memory regions.
   ///
@@ -61,6 +110,85 @@ extern "C" {
   /// \return PUB_OK if the message was valid and received by the publisher.
   publisher_error publisher_publish(publisher_t *publisher, const void* data, const size_t length);
 
+  /// Publish a message to the subscribers whose filter matches \p tag.
+  ///
+  /// A subscriber matches if its filter shares at least one bit with \p tag. Subscribers that
+  /// don't match are neither written to nor woken up.
+  ///
+  /// \param publisher the publisher that will publish this message to is subscribers.
+  /// \param data the payload to publish.
+  /// \param length the length of the message payload.
+  /// \param tag the tag bitmask of this message.
+  /// \return PUB_OK if the message was valid and received by the publisher.
+  publisher_error publisher_publish_tagged(
+    publisher_t *publisher, const void* data, const size_t length, const unsigned long tag);
+
+  /// Publish a message on priority lane \p lane to the subscribers whose filter matches \p tag.
+  ///
+  /// Lane 0 is the lowest priority and is used by all other publish functions. The publisher
+  /// writes queued messages of higher lanes first, and subscribers dispatch them ahead of
+  /// pending messages of lower lanes.
+  ///
+  /// \param publisher the publisher that will publish this message to is subscribers.
+  /// \param data the payload to publish.
+  /// \param length the length of the message payload.
+  /// \param tag the tag bitmask of this message.
+  /// \param lane the priority lane, below the publisher's number of lanes.
+  /// \return PUB_OK if the message was valid and received by the publisher.
+  publisher_error publisher_publish_lane(
+    publisher_t *publisher, const void* data, const size_t length, const unsigned long tag,
+    const int lane);
+
+  /// The maximum allowed size of messages, as given to \ref publisher_create.
+  ///
+  /// \param publisher the publisher handle.
+  /// \return the publisher's buffer size.
+  size_t publisher_buffer_size(publisher_t *publisher);
+
+  /// Borrow a buffer of the publisher's buffer size, aligned to \ref PUB_SLOT_ALIGN, to build
+  /// a message in place. Unlike \ref publisher_publish, the publisher owns the buffer, so the
+  /// caller does not need to keep it alive until the message has been written to subscribers.
+  ///
+  /// The loan is heap memory in this process, not a shared memory slot: it only saves the
+  /// caller its own serialization buffer. Publishing still copies the message into the slot of
+  /// every matching subscriber.
+  ///
+  /// The buffer must be handed back with either \ref publisher_publish_loan or
+  /// \ref publisher_return_loan.
+  ///
+  /// \param publisher the publisher to borrow the buffer from.
+  /// \return the loaned buffer, or NULL if it could not be allocated.
+  void *publisher_loan(publisher_t *publisher);
+
+  /// Publish a message built in a buffer from \ref publisher_loan to the subscribers whose
+  /// filter matches \p tag. The loan is given back to the publisher whatever the result.
+  ///
+  /// \param publisher the publisher the buffer was loaned from.
+  /// \param loan the loaned buffer holding the payload.
+  /// \param length the length of the message payload.
+  /// \param tag the tag bitmask of this message.
+  /// \return PUB_OK if the message was valid and received by the publisher.
+  publisher_error publisher_publish_loan(
+    publisher_t *publisher, void *loan, const size_t length, const unsigned long tag);
+
+  /// Like \ref publisher_publish_loan, on priority lane \p lane, see \ref publisher_publish_lane.
+  ///
+  /// \param publisher the publisher the buffer was loaned from.
+  /// \param loan the loaned buffer holding the payload.
+  /// \param length the length of the message payload.
+  /// \param tag the tag bitmask of this message.
+  /// \param lane the priority lane, below the publisher's number of lanes.
+  /// \return PUB_OK if the message was valid and received by the publisher.
+  publisher_error publisher_publish_loan_lane(
+    publisher_t *publisher, void *loan, const size_t length, const unsigned long tag,
+    const int lane);
+
+  /// Give back a buffer from \ref publisher_loan without publishing it.
+  ///
+  /// \param publisher the publisher the buffer was loaned from.
+  /// \param loan the loaned buffer.
+  void publisher_return_loan(publisher_t *publisher, void *loan);
+
 #ifdef __cplusplus
 } //end extern "C"
 #endif
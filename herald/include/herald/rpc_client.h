@@ -0,0 +1,107 @@
+#pragma once
+
+/// \addtogroup API
+/// @{
+
+#include <stdlib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  /// Return code for rpc client functions.
+  enum rpc_client_error {
+    /// Operation was successful.
+    RPC_CLIENT_OK = 0,
+
+    /// Could not create and connect socket to rpc server.
+    RPC_CLIENT_NOSOCKET,
+
+    /// Bad response from rpc server, aborted.
+    RPC_CLIENT_BADRESP,
+
+    /// Could not initialize shared memory region.
+    RPC_CLIENT_NOSHAREDMEM,
+
+    /// Attempted to call on an uninitialized client.
+    RPC_CLIENT_NOTRUNNING,
+
+    /// Request exceeds buffer size, or reply exceeds the caller's reply buffer.
+    RPC_CLIENT_TOOLARGE,
+
+    /// A previous call is still outstanding on this client.
+    RPC_CLIENT_BUSY,
+
+    /// No reply was received before the timeout elapsed.
+    RPC_CLIENT_TIMEOUT
+  };
+
+  struct rpc_client_t;
+
+  /// Function to be called when the reply to an async call arrives.
+  ///
+  /// NOTE: The pointer to \p reply is only valid for the lifetime of this function
+  /// call, if it needs to last longer a copy should be made.
+  ///
+  /// \param call_id the correlation id returned by \ref rpc_client_call_async.
+  /// \param reply the reply payload.
+  /// \param len the length of the reply payload.
+  typedef void (*rpc_reply_callback_t)(unsigned long call_id, const void *reply, size_t len);
+
+  /// Create an opaque rpc client handle. Does not initialize connection to the server.
+  ///
+  /// NOTE: should not be freed, use \ref rpc_client_destroy to shutdown and cleanup the
+  /// client.
+  ///
+  /// \param port the tcp port the rpc server is running on.
+  /// \return an uninitialized rpc client handle.
+  rpc_client_t *rpc_client_create(const int port);
+
+  /// Destroy an rpc client. If it was initialized, it will close the remote connection
+  /// to the server and cleanup the shared memory region.
+  ///
+  /// \param client the rpc client handle to destroy.
+  void rpc_client_destroy(rpc_client_t *client);
+
+  /// Initialize an rpc client. This will connect to the remote server and initialize
+  /// the shared memory region.
+  ///
+  /// \param client the rpc client handle to initialize.
+  /// \return RPC_CLIENT_OK if initialization was successful or an errorcode if not.
+  rpc_client_error rpc_client_init(rpc_client_t *client);
+
+  /// Send a request and block until its reply arrives or the timeout elapses.
+  ///
+  /// Each client has a single request slot, so only one call may be outstanding at a
+  /// time. After a timeout the client stays busy until the late reply has arrived.
+  ///
+  /// \param client the rpc client to call through.
+  /// \param request the request payload.
+  /// \param request_len the length of the request payload.
+  /// \param reply the buffer the reply payload is copied into.
+  /// \param reply_capacity the size of \p reply.
+  /// \param reply_len set to the length of the reply payload.
+  /// \param timeout_ms how long to wait for the reply, in milliseconds.
+  /// \return RPC_CLIENT_OK if a reply was received or an errorcode if not.
+  rpc_client_error rpc_client_call(
+    rpc_client_t *client, const void *request, const size_t request_len,
+    void *reply, const size_t reply_capacity, size_t *reply_len, const int timeout_ms);
+
+  /// Send a request and return immediately; \p callback is called with the reply from
+  /// the client's reply thread.
+  ///
+  /// \param client the rpc client to call through.
+  /// \param request the request payload.
+  /// \param request_len the length of the request payload.
+  /// \param callback the function called with the reply.
+  /// \param call_id set to the correlation id passed to \p callback.
+  /// \return RPC_CLIENT_OK if the request was sent or an errorcode if not.
+  rpc_client_error rpc_client_call_async(
+    rpc_client_t *client, const void *request, const size_t request_len,
+    const rpc_reply_callback_t callback, unsigned long *call_id);
+
+#ifdef __cplusplus
+} //end extern "C"
+#endif
+
+/// @}
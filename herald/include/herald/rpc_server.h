@@ -0,0 +1,67 @@
+#pragma once
+
+/// \addtogroup API
+/// @{
+
+#include <stdlib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  struct rpc_server_t;
+
+  /// Return code for rpc server functions.
+  enum rpc_server_error {
+    /// Operation was successful.
+    RPC_SERVER_OK = 0,
+
+    /// Could not create and bind to the socket.
+    RPC_SERVER_NOSOCKET
+  };
+
+  /// Function to be called for each request received from an rpc client.
+  ///
+  /// The reply is written directly into the client's reply slot in shared memory.
+  ///
+  /// NOTE: The pointers to \p request and \p reply are only valid for the lifetime of
+  /// this function call. Handlers for different clients may run concurrently.
+  ///
+  /// \param request the request payload.
+  /// \param request_len the length of the request payload.
+  /// \param reply the buffer to write the reply payload into.
+  /// \param reply_capacity the size of the reply buffer.
+  /// \return the length of the reply written to \p reply, at most \p reply_capacity.
+  typedef size_t (*rpc_handler_t)(
+    const void *request, size_t request_len, void *reply, size_t reply_capacity);
+
+  /// Create an rpc server. Does not initialize server until \ref rpc_server_init is called.
+  ///
+  /// NOTE: should not be freed, use \ref rpc_server_destroy to shutdown and cleanup the
+  /// server.
+  ///
+  /// \param port the port to bind the server which accepts client connections.
+  /// \param buffer_size the maximum allowed size of requests and replies.
+  /// \param handler the function called to answer each request.
+  /// \return an uninitialized rpc server handle.
+  rpc_server_t *rpc_server_create(
+    const int port, const size_t buffer_size, const rpc_handler_t handler);
+
+  /// Destroy an rpc server. If it was initialized, it will close server connection and
+  /// disconnect all connected clients as well as destroying all shared memory regions.
+  ///
+  /// \param server the rpc server handle to destroy.
+  void rpc_server_destroy(rpc_server_t *server);
+
+  /// Initialize an rpc server. This will bind to the configured tcp port and start accepting
+  /// connections from clients.
+  ///
+  /// \param server the rpc server to initialize.
+  /// \return RPC_SERVER_OK if initialization was successful or an errcode if not.
+  rpc_server_error rpc_server_init(rpc_server_t *server);
+
+#ifdef __cplusplus
+} //end extern "C"
+#endif
+
+/// @}
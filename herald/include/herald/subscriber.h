@@ -5,6 +5,8 @@
 
 #include <stdlib.h>
 
+#include "thread_attr.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -21,9 +23,35 @@ extern "C" {
     SUB_BADRESP,
 
     /// Could not initialize shared memory region.
-    SUB_NOSHAREDMEM
+    SUB_NOSHAREDMEM,
+
+    /// Could not apply the thread attributes to the subscriber's thread.
+    SUB_NOTHREADATTR
+  };
+
+  /// Filter matching every message tag, the default of \ref subscriber_attr_t.
+#define SUB_FILTER_ALL (~0UL)
+
+  /// Attributes of the subscriber.
+  struct subscriber_attr_t {
+    /// The thread invoking the callback.
+    herald_thread_attr_t callback_thread;
+
+    /// If non-zero, \ref subscriber_init fails with SUB_BADRESP unless the publisher's
+    /// buffer size is exactly this, e.g. the size of a fixed-layout message.
+    size_t expected_buffer_size;
+
+    /// The tag bitmask this subscriber is interested in. Only messages whose tag shares at
+    /// least one bit with it are delivered, see \ref publisher_publish_tagged.
+    unsigned long filter;
   };
 
+  /// Reset \p attr to the defaults, which leave the thread unchanged, accept any buffer size
+  /// and receive every message.
+  ///
+  /// \param attr the subscriber attributes to reset.
+  void subscriber_attr_init(subscriber_attr_t *attr);
+
   struct subscriber_t;
 
   /// Function to be called when new data arrives from publisher.
@@ -35,6 +63,52 @@ extern "C" {
   /// \param len the length of the buffer.
   typedef void (*callback_t)(const void *data, size_t len);
 
+  /// Metadata delivered alongside each message to a \ref callback_ex_t.
+  ///
+  /// All timestamps are CLOCK_MONOTONIC in nanoseconds, so they are comparable between
+  /// the publisher and subscriber processes.
+  struct message_info_t {
+    /// Sequence number assigned by the publisher, counted separately for each \ref lane.
+    /// Gaps within a lane mean messages were filtered out or overwritten before this
+    /// subscriber picked them up. Sequences of different lanes are unrelated, since higher
+    /// lanes overtake lower ones.
+    unsigned long sequence;
+
+    /// Tag the message was published with, see \ref publisher_publish_tagged.
+    unsigned long tag;
+
+    /// When \ref publisher_publish accepted the message.
+    long publish_ns;
+
+    /// When the publish thread wrote the message into this subscriber's slot.
+    long write_ns;
+
+    /// When this subscriber's callback thread picked the message up.
+    long deliver_ns;
+
+    /// Priority lane the message was published on, see \ref publisher_publish_lane.
+    int lane;
+  };
+
+  /// Function to be called with each new message and its metadata.
+  ///
+  /// NOTE: The pointers to \p data and \p info are only valid for the lifetime of this
+  /// function call, if they need to last longer a copy should be made.
+  ///
+  /// \param data the buffer of data received.
+  /// \param len the length of the buffer.
+  /// \param info the sequence number and timestamps of the message.
+  typedef void (*callback_ex_t)(const void *data, size_t len, const message_info_t *info);
+
+  /// Like \ref callback_ex_t, with the user pointer given to \ref subscriber_create_ctx.
+  ///
+  /// \param data the buffer of data received.
+  /// \param len the length of the buffer.
+  /// \param info the sequence number and timestamps of the message.
+  /// \param ctx the user pointer the subscriber was created with.
+  typedef void (*callback_ctx_t)(
+    const void *data, size_t len, const message_info_t *info, void *ctx);
+
   /// Create an opaque subscriber handle. Does not initialize connection to publisher.
   ///
   /// NOTE: should not be freed, use \ref subscriber_destroy to shutdown and cleanup the
@@ -45,6 +119,37 @@ extern "C" {
   /// \return an unititialized subscriber handle.
   subscriber_t *subscriber_create(const int port, const callback_t callback);
 
+  /// Create an opaque subscriber handle configured by \p attr, e.g. with a tag filter or
+  /// the attributes \ref subscriber_init starts its callback thread with.
+  ///
+  /// \param port the tcp port the publisher is running on.
+  /// \param callback a callback function to be called when a new message is received.
+  /// \param attr the subscriber attributes copied by this call, or NULL for the defaults.
+  /// \return an unititialized subscriber handle.
+  subscriber_t *subscriber_create_with_attr(
+    const int port, const callback_t callback, const subscriber_attr_t *attr);
+
+  /// Create an opaque subscriber handle whose callback also receives the message's
+  /// \ref message_info_t. Does not initialize connection to publisher.
+  ///
+  /// \param port the tcp port the publisher is running on.
+  /// \param callback a callback function to be called when a new message is received.
+  /// \param attr the subscriber attributes, or NULL for the defaults.
+  /// \return an unititialized subscriber handle.
+  subscriber_t *subscriber_create_ex(
+    const int port, const callback_ex_t callback, const subscriber_attr_t *attr);
+
+  /// Create an opaque subscriber handle whose callback is passed \p ctx with every message,
+  /// e.g. to carry the state of a C++ closure. Does not initialize connection to publisher.
+  ///
+  /// \param port the tcp port the publisher is running on.
+  /// \param callback a callback function to be called when a new message is received.
+  /// \param ctx a user pointer passed through to \p callback.
+  /// \param attr the subscriber attributes, or NULL for the defaults.
+  /// \return an unititialized subscriber handle.
+  subscriber_t *subscriber_create_ctx(
+    const int port, const callback_ctx_t callback, void *ctx, const subscriber_attr_t *attr);
+
   /// Destroy a subscriber. If it was initialized, it will close the remote connection
   /// to the publisher and cleanup the shared memory region.
   ///
@@ -58,6 +163,26 @@ extern "C" {
   /// \return SUB_OK if initialization was successful or an errorcode if not.
   subscriber_error subscriber_init(subscriber_t *subscriber);
 
+  /// Change the filter of a subscriber. Takes effect for messages published after this call.
+  ///
+  /// \param subscriber the subscriber handle to update.
+  /// \param filter the tag bitmask this subscriber is interested in.
+  void subscriber_set_filter(subscriber_t *subscriber, const unsigned long filter);
+
+  /// The buffer size announced by the publisher, i.e. the largest message this subscriber
+  /// can receive.
+  ///
+  /// \param subscriber an initialized subscriber handle.
+  /// \return the publisher's buffer size, or 0 if the subscriber is not initialized.
+  size_t subscriber_buffer_size(subscriber_t *subscriber);
+
+  /// The number of priority lanes announced by the publisher. When messages are pending on
+  /// several lanes, the callback is called with the highest lane first.
+  ///
+  /// \param subscriber an initialized subscriber handle.
+  /// \return the publisher's number of lanes, or 0 if the subscriber is not initialized.
+  int subscriber_num_lanes(subscriber_t *subscriber);
+
 #ifdef __cplusplus
 } //end extern "C"
 #endif
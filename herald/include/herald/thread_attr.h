@@ -0,0 +1,48 @@
+#pragma once
+
+/// \addtogroup API
+/// @{
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  /// Number of cpus a \ref herald_thread_attr_t can pin a thread to, the size of cpu_set_t.
+#define HERALD_MAX_CPUS 1024
+
+  /// Number of words in \ref herald_thread_attr_t::cpu_mask.
+#define HERALD_CPU_MASK_WORDS (HERALD_MAX_CPUS / (8 * sizeof(unsigned long)))
+
+  /// Scheduling attributes for one of herald's internal threads.
+  struct herald_thread_attr_t {
+    /// Bitmask of the cpus the thread may run on, cpu N being bit N % 64 of word N / 64, most
+    /// easily set with \ref herald_thread_attr_set_cpu. All zero leaves the affinity unchanged.
+    unsigned long cpu_mask[HERALD_CPU_MASK_WORDS];
+
+    /// SCHED_FIFO priority of the thread. 0 leaves the default scheduling policy.
+    ///
+    /// NOTE: real-time priorities usually require CAP_SYS_NICE or an RLIMIT_RTPRIO.
+    int priority;
+
+    /// Name of the thread, truncated to 15 characters. NULL leaves the name unchanged.
+    const char *name;
+  };
+
+  /// Reset \p attr to the defaults, which leave the thread's affinity, scheduling and
+  /// name unchanged.
+  ///
+  /// \param attr the thread attributes to reset.
+  void herald_thread_attr_init(herald_thread_attr_t *attr);
+
+  /// Add \p cpu to the cpus the thread may run on.
+  ///
+  /// \param attr the thread attributes to update.
+  /// \param cpu the cpu number, below \ref HERALD_MAX_CPUS.
+  /// \return 0, or -1 if \p cpu is out of range.
+  int herald_thread_attr_set_cpu(herald_thread_attr_t *attr, const int cpu);
+
+#ifdef __cplusplus
+} //end extern "C"
+#endif
+
+/// @}
@@ -0,0 +1,73 @@
+#pragma once
+
+/// \addtogroup API
+/// @{
+
+#include <stdlib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  /// Point in a message's path recorded by the trace ring.
+  enum herald_trace_event_type {
+    /// \ref publisher_publish accepted the message.
+    TRACE_PUBLISH = 0,
+
+    /// The publish thread wrote the message into a subscriber's slot.
+    TRACE_WRITE,
+
+    /// A subscriber's callback thread woke up and picked up the message.
+    TRACE_DELIVER,
+
+    /// A subscriber's callback returned.
+    TRACE_CALLBACK_DONE
+  };
+
+  /// A single trace ring entry.
+  struct herald_trace_event_t {
+    /// CLOCK_MONOTONIC timestamp of the event, in nanoseconds.
+    long timestamp_ns;
+
+    /// Sequence number of the message, assigned by the publisher per lane.
+    unsigned long sequence;
+
+    /// The tcp port of the publisher the message belongs to.
+    int port;
+
+    /// Priority lane of the message, which together with \ref sequence identifies it.
+    int lane;
+
+    /// Which \ref herald_trace_event_type this is.
+    int type;
+  };
+
+  /// Enable the in-process trace ring. Publishers and subscribers in this process record
+  /// their events into it from then on, overwriting the oldest events when full.
+  ///
+  /// NOTE: the ring is allocated once and lives until the process exits; only the first
+  /// call has any effect.
+  ///
+  /// \param capacity the number of events kept, rounded up to a power of two.
+  /// \return 1 if the ring was enabled by this call, 0 if it already was.
+  int herald_trace_enable(const size_t capacity);
+
+  /// Copy the most recent events out of the trace ring, oldest first. Events being
+  /// overwritten while copying are skipped.
+  ///
+  /// \param events the buffer to copy events into.
+  /// \param max_events the size of \p events.
+  /// \return the number of events copied.
+  size_t herald_trace_snapshot(herald_trace_event_t *events, const size_t max_events);
+
+  /// Write the most recent events to \p fd as text, one event per line, oldest first.
+  ///
+  /// \param fd the file descriptor to write to.
+  /// \return the number of events written.
+  size_t herald_trace_dump(const int fd);
+
+#ifdef __cplusplus
+} //end extern "C"
+#endif
+
+/// @}
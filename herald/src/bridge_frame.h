@@ -0,0 +1,38 @@
+#pragma once
+
+#include <endian.h>
+#include <stdint.h>
+#include <string.h>
+
+// Wire format between bridge sender and receiver. After a one line text handshake
+// ("herald-bridge <buffer_size> <num_lanes>\n") the stream is a sequence of frames, each
+// a BridgeFrameHeader in network byte order followed by length bytes of payload.
+struct BridgeFrameHeader {
+  uint32_t length;
+  uint32_t lane;
+  uint64_t sequence;
+  uint64_t tag;
+};
+
+static const char kBridgeHandshake[] = "herald-bridge";
+
+inline void bridge_frame_encode(
+    uint8_t *out, const uint32_t length, const uint32_t lane, const uint64_t sequence,
+    const uint64_t tag) {
+  BridgeFrameHeader header;
+  header.length = htobe32(length);
+  header.lane = htobe32(lane);
+  header.sequence = htobe64(sequence);
+  header.tag = htobe64(tag);
+  memcpy(out, &header, sizeof(header));
+}
+
+inline void bridge_frame_decode(
+    const uint8_t *in, uint32_t *length, uint32_t *lane, uint64_t *sequence, uint64_t *tag) {
+  BridgeFrameHeader header;
+  memcpy(&header, in, sizeof(header));
+  *length = be32toh(header.length);
+  *lane = be32toh(header.lane);
+  *sequence = be64toh(header.sequence);
+  *tag = be64toh(header.tag);
+}
@@ -0,0 +1,223 @@
+#include <herald/bridge_receiver.h>
+#include <herald/publisher.h>
+
+#include <atomic>
+#include <functional>
+#include <iostream>
+#include <poll.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "bridge_frame.h"
+#include "connection.h"
+
+// Size of each read from the bridge socket, large enough to pull in whole batches.
+static const size_t kBridgeReadSize = 1 << 16;
+
+struct bridge_receiver_t {
+  bridge_receiver_t(const char *host, const int bridge_port, const int publish_port);
+  ~bridge_receiver_t();
+
+  bridge_receiver_error init();
+  void get_stats(bridge_receiver_stats_t *stats);
+
+  size_t republish(const uint8_t *data, const size_t length);
+
+  void thread_receive();
+
+  // members
+  const std::string _host;
+  const int _bridge_port;
+  const int _publish_port;
+
+  int _client_fd;
+  int _buffer_size;
+  int _num_lanes;
+  publisher_t *_publisher;
+
+  // Tracked per lane, since the sender's sequences are per lane.
+  bool _have_sequence[PUB_MAX_LANES];
+  uint64_t _next_sequence[PUB_MAX_LANES];
+
+  std::atomic<bool> _running;
+  std::atomic<bool> _connected;
+  std::thread _receive_thread;
+
+  std::atomic<unsigned long> _messages;
+  std::atomic<unsigned long> _gaps;
+  std::atomic<unsigned long> _lost;
+  std::atomic<unsigned long> _resyncs;
+};
+
+// API functions
+// --------------------------------------------------
+
+bridge_receiver_t *bridge_receiver_create(
+    const char *host, const int bridge_port, const int publish_port) {
+  return new bridge_receiver_t(host, bridge_port, publish_port);
+}
+
+void bridge_receiver_destroy(bridge_receiver_t *receiver) {
+  delete receiver;
+}
+
+bridge_receiver_error bridge_receiver_init(bridge_receiver_t *receiver) {
+  return receiver->init();
+}
+
+void bridge_receiver_get_stats(bridge_receiver_t *receiver, bridge_receiver_stats_t *stats) {
+  receiver->get_stats(stats);
+}
+
+// Implementation
+// --------------------------------------------------
+
+bridge_receiver_t::bridge_receiver_t(
+    const char *host, const int bridge_port, const int publish_port)
+  : _host(host)
+  , _bridge_port(bridge_port)
+  , _publish_port(publish_port)
+  , _client_fd(-1)
+  , _buffer_size(0)
+  , _num_lanes(1)
+  , _publisher(nullptr)
+  , _have_sequence()
+  , _next_sequence()
+  , _running(false)
+  , _connected(false)
+  , _messages(0)
+  , _gaps(0)
+  , _lost(0)
+  , _resyncs(0) {}
+
+bridge_receiver_t::~bridge_receiver_t() {
+  if (_running) {
+    _running = false;
+    _receive_thread.join();
+  }
+
+  if (_client_fd != -1) {
+    close(_client_fd);
+  }
+
+  if (_publisher != nullptr) {
+    publisher_destroy(_publisher);
+  }
+}
+
+bridge_receiver_error bridge_receiver_t::init() {
+  if ((_client_fd = connection_connect(_host.c_str(), _bridge_port)) == -1) {
+    return BRIDGE_RECEIVER_NOSOCKET;
+  }
+
+  ConnectionHandshake handshake;
+  if (!connection_handshake_read(_client_fd, &handshake) || handshake.id != kBridgeHandshake) {
+    return BRIDGE_RECEIVER_BADRESP;
+  }
+  _buffer_size = handshake.buffer_size;
+  _num_lanes = handshake.num_lanes;
+
+  // Mirror the remote channel's lanes so priorities survive the hop.
+  publisher_attr_t attr;
+  publisher_attr_init(&attr);
+  attr.num_lanes = _num_lanes;
+
+  _publisher = publisher_create_with_attr(_publish_port, _buffer_size, &attr);
+  if (PUB_OK != publisher_init(_publisher)) {
+    return BRIDGE_RECEIVER_NOPUBLISHER;
+  }
+
+  _running = true;
+  _connected = true;
+  _receive_thread = std::thread(std::bind(&bridge_receiver_t::thread_receive, this));
+
+  return BRIDGE_RECEIVER_OK;
+}
+
+void bridge_receiver_t::get_stats(bridge_receiver_stats_t *stats) {
+  stats->messages = _messages;
+  stats->gaps = _gaps;
+  stats->lost = _lost;
+  stats->resyncs = _resyncs;
+  stats->connected = _connected ? 1 : 0;
+}
+
+// Republish every complete frame in data, returning the number of bytes consumed, or
+// length + 1 if the stream is corrupt.
+size_t bridge_receiver_t::republish(const uint8_t *data, const size_t length) {
+  size_t offset = 0;
+  while (length - offset >= sizeof(BridgeFrameHeader)) {
+    uint32_t frame_length;
+    uint32_t lane;
+    uint64_t sequence;
+    uint64_t tag;
+    bridge_frame_decode(data + offset, &frame_length, &lane, &sequence, &tag);
+
+    if (frame_length > (uint32_t) _buffer_size || lane >= (uint32_t) _num_lanes) {
+      return length + 1;
+    }
+
+    if (length - offset - sizeof(BridgeFrameHeader) < frame_length) {
+      break;
+    }
+
+    if (_have_sequence[lane] && sequence > _next_sequence[lane]) {
+      _gaps++;
+      _lost += sequence - _next_sequence[lane];
+    } else if (_have_sequence[lane] && sequence < _next_sequence[lane]) {
+      _resyncs++;
+    }
+    _have_sequence[lane] = true;
+    _next_sequence[lane] = sequence + 1;
+
+    void *loan = publisher_loan(_publisher);
+    if (loan != nullptr) {
+      memcpy(loan, data + offset + sizeof(BridgeFrameHeader), frame_length);
+      // Keep the publisher's tag, so remote subscribers filter exactly like local ones.
+      publisher_publish_loan_lane(_publisher, loan, frame_length, tag, lane);
+    }
+    _messages++;
+
+    offset += sizeof(BridgeFrameHeader) + frame_length;
+  }
+
+  return offset;
+}
+
+void bridge_receiver_t::thread_receive() {
+  std::vector<uint8_t> buffer(kBridgeReadSize + sizeof(BridgeFrameHeader) + _buffer_size);
+  size_t buffered = 0;
+
+  struct pollfd client_poll;
+  client_poll.fd = _client_fd;
+  client_poll.events = POLLIN;
+
+  while (_running) {
+    if (poll(&client_poll, 1, 1000) <= 0 || !(client_poll.revents & (POLLIN | POLLHUP))) {
+      continue;
+    }
+
+    const size_t space = buffer.size() - buffered;
+    const ssize_t bytes_read = recv(_client_fd, buffer.data() + buffered, space, 0);
+    if (bytes_read <= 0) {
+      std::cerr << "bridge sender disconnected" << std::endl;
+      break;
+    }
+    buffered += bytes_read;
+
+    const size_t consumed = republish(buffer.data(), buffered);
+    if (consumed > buffered) {
+      std::cerr << "bad frame from bridge sender" << std::endl;
+      break;
+    }
+
+    memmove(buffer.data(), buffer.data() + consumed, buffered - consumed);
+    buffered -= consumed;
+  }
+
+  _connected = false;
+}
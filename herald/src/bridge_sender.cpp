@@ -0,0 +1,304 @@
+#include <herald/bridge_sender.h>
+#include <herald/subscriber.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <errno.h>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "bridge_frame.h"
+#include "connection.h"
+
+// How far, in batches, a receiver may fall behind before it is disconnected.
+static const size_t kBridgeMaxBacklogBatches = 4;
+
+// A connected bridge receiver and the bytes its socket has not accepted yet.
+struct bridge_peer_t {
+  int fd;
+  std::vector<uint8_t> backlog;
+};
+
+struct bridge_sender_t {
+  bridge_sender_t(const int local_port, const int bridge_port, const size_t max_batch_bytes);
+  ~bridge_sender_t();
+
+  bridge_sender_error init();
+  void get_stats(bridge_sender_stats_t *stats);
+
+  void append(const void *data, const size_t length, const message_info_t *info);
+  static bool send_backlog(bridge_peer_t &peer);
+  bool accept_receiver(const int fd);
+
+  static void on_message(
+    const void *data, size_t length, const message_info_t *info, void *ctx);
+
+  // Thread functions
+  void thread_server();
+  void thread_flush();
+
+  // Members
+  const int _local_port;
+  const int _bridge_port;
+  const size_t _max_batch_bytes;
+
+  subscriber_t *_subscriber;
+  int _server_fd;
+  std::string _open_resp;
+
+  std::atomic<bool> _running;
+  std::thread _server_thread;
+  std::thread _flush_thread;
+
+  // Frames waiting to be written, appended to by the subscriber callback.
+  std::mutex _batch_mutex;
+  std::condition_variable _batch_cv;
+  std::vector<uint8_t> _batch;
+  unsigned long _batch_messages;
+
+  // Only held for non-blocking writes, so accepting receivers is never held up.
+  std::mutex _receiver_mutex;
+  std::vector<bridge_peer_t> _receivers;
+
+  std::atomic<unsigned long> _messages;
+  std::atomic<unsigned long> _batches;
+  std::atomic<unsigned long> _dropped;
+  std::atomic<unsigned long> _disconnected;
+};
+
+// API functions
+// --------------------------------------------------
+
+bridge_sender_t *bridge_sender_create(
+    const int local_port, const int bridge_port, const size_t max_batch_bytes) {
+  return new bridge_sender_t(local_port, bridge_port, max_batch_bytes);
+}
+
+void bridge_sender_destroy(bridge_sender_t *sender) {
+  delete sender;
+}
+
+bridge_sender_error bridge_sender_init(bridge_sender_t *sender) {
+  return sender->init();
+}
+
+void bridge_sender_get_stats(bridge_sender_t *sender, bridge_sender_stats_t *stats) {
+  sender->get_stats(stats);
+}
+
+// Implementation
+// --------------------------------------------------
+
+bridge_sender_t::bridge_sender_t(
+    const int local_port, const int bridge_port, const size_t max_batch_bytes)
+  : _local_port(local_port)
+  , _bridge_port(bridge_port)
+  , _max_batch_bytes(max_batch_bytes)
+  , _subscriber(nullptr)
+  , _server_fd(-1)
+  , _running(false)
+  , _batch_messages(0)
+  , _messages(0)
+  , _batches(0)
+  , _dropped(0)
+  , _disconnected(0) {}
+
+bridge_sender_t::~bridge_sender_t() {
+  // Stop the callback first so nothing is appended after the flush thread exits.
+  if (_subscriber != nullptr) {
+    subscriber_destroy(_subscriber);
+  }
+
+  if (_running) {
+    _running = false;
+    _server_thread.join();
+    _flush_thread.join();
+  }
+
+  for (const bridge_peer_t &peer : _receivers) {
+    close(peer.fd);
+  }
+
+  if (_server_fd != -1) {
+    close(_server_fd);
+  }
+}
+
+bridge_sender_error bridge_sender_t::init() {
+  if ((_server_fd = connection_listen(_bridge_port)) == -1) {
+    return BRIDGE_SENDER_NOSOCKET;
+  }
+
+  _subscriber = subscriber_create_ctx(_local_port, &bridge_sender_t::on_message, this, nullptr);
+  if (SUB_OK != subscriber_init(_subscriber)) {
+    return BRIDGE_SENDER_NOSUBSCRIBER;
+  }
+
+  _open_resp = connection_handshake_format(ConnectionHandshake{
+    kBridgeHandshake, (int) subscriber_buffer_size(_subscriber),
+    subscriber_num_lanes(_subscriber)});
+
+  _running = true;
+  _server_thread = std::thread(std::bind(&bridge_sender_t::thread_server, this));
+  _flush_thread = std::thread(std::bind(&bridge_sender_t::thread_flush, this));
+  return BRIDGE_SENDER_OK;
+}
+
+void bridge_sender_t::get_stats(bridge_sender_stats_t *stats) {
+  stats->messages = _messages;
+  stats->batches = _batches;
+  stats->dropped = _dropped;
+  stats->disconnected = _disconnected;
+}
+
+void bridge_sender_t::on_message(
+    const void *data, size_t length, const message_info_t *info, void *ctx) {
+  static_cast<bridge_sender_t*>(ctx)->append(data, length, info);
+}
+
+void bridge_sender_t::append(const void *data, const size_t length, const message_info_t *info) {
+  const size_t frame_size = sizeof(BridgeFrameHeader) + length;
+
+  std::unique_lock<std::mutex> lock(_batch_mutex);
+  if (!_batch.empty() && _batch.size() + frame_size > _max_batch_bytes) {
+    _dropped++;
+    return;
+  }
+
+  const size_t offset = _batch.size();
+  _batch.resize(offset + frame_size);
+  bridge_frame_encode(
+    _batch.data() + offset, length, info->lane, info->sequence, info->tag);
+  memcpy(_batch.data() + offset + sizeof(BridgeFrameHeader), data, length);
+  _batch_messages++;
+  _batch_cv.notify_one();
+}
+
+bool bridge_sender_t::accept_receiver(const int fd) {
+  // Batching is done here, don't let Nagle hold back small batches.
+  int opt = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+
+  // Sent under the lock, so the handshake goes out ahead of any batch. A new socket
+  // always has room for it.
+  std::unique_lock<std::mutex> receiver_lock(_receiver_mutex);
+  bridge_peer_t peer{fd, std::vector<uint8_t>(_open_resp.begin(), _open_resp.end())};
+  if (!send_backlog(peer) || !peer.backlog.empty()) {
+    close(fd);
+    return false;
+  }
+  _receivers.push_back(std::move(peer));
+
+  // The flush thread owns the connection from here and notices disconnects when writing.
+  return false;
+}
+
+void bridge_sender_t::thread_server() {
+  connection_serve(
+    _server_fd, _running,
+    std::bind(&bridge_sender_t::accept_receiver, this, std::placeholders::_1),
+    [](int) {});
+}
+
+// Write as much of the backlog as the socket accepts without blocking. Returns false if the
+// connection failed.
+bool bridge_sender_t::send_backlog(bridge_peer_t &peer) {
+  size_t sent = 0;
+  while (sent < peer.backlog.size()) {
+    const ssize_t rc = send(
+      peer.fd, peer.backlog.data() + sent, peer.backlog.size() - sent,
+      MSG_NOSIGNAL | MSG_DONTWAIT);
+    if (rc < 0) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+        break;
+      }
+      return false;
+    }
+    sent += rc;
+  }
+
+  peer.backlog.erase(peer.backlog.begin(), peer.backlog.begin() + sent);
+  return true;
+}
+
+void bridge_sender_t::thread_flush() {
+  const size_t max_backlog = kBridgeMaxBacklogBatches * _max_batch_bytes;
+
+  std::vector<uint8_t> sending;
+  sending.reserve(_max_batch_bytes);
+  bool receivers_behind = false;
+  bool forwarded = false;
+
+  while (_running) {
+    unsigned long num_messages = 0;
+    bool have_batch;
+    {
+      // Wake up sooner while a receiver has a backlog, to keep draining it without new data.
+      const std::chrono::milliseconds wait(receivers_behind ? 1 : 100);
+
+      std::unique_lock<std::mutex> lock(_batch_mutex);
+      have_batch = _batch_cv.wait_for(lock, wait, [this] { return !_batch.empty(); });
+
+      if (have_batch) {
+        // Swap buffers so the callback keeps appending while this batch is written.
+        std::swap(sending, _batch);
+        _batch.clear();
+        num_messages = _batch_messages;
+        _batch_messages = 0;
+      }
+    }
+
+    if (!have_batch && !receivers_behind) {
+      continue;
+    }
+
+    {
+      std::unique_lock<std::mutex> receiver_lock(_receiver_mutex);
+      receivers_behind = false;
+      forwarded = false;
+      for (auto it = _receivers.begin(); it != _receivers.end();) {
+        bridge_peer_t &peer = *it;
+
+        bool keep = true;
+        if (have_batch) {
+          if (!peer.backlog.empty() && peer.backlog.size() + sending.size() > max_backlog) {
+            std::cerr << "disconnecting bridge receiver that fell behind" << std::endl;
+            keep = false;
+          } else {
+            peer.backlog.insert(peer.backlog.end(), sending.begin(), sending.end());
+          }
+        }
+
+        if (keep && !send_backlog(peer)) {
+          keep = false;
+        }
+
+        if (!keep) {
+          close(peer.fd);
+          it = _receivers.erase(it);
+          _disconnected++;
+        } else {
+          receivers_behind |= !peer.backlog.empty();
+          forwarded |= have_batch;
+          ++it;
+        }
+      }
+    }
+
+    // Batches no receiver took, e.g. while none is connected, are not counted as forwarded.
+    if (have_batch && forwarded) {
+      _messages += num_messages;
+      _batches++;
+    }
+  }
+}
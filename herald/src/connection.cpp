@@ -0,0 +1,166 @@
+#include "connection.h"
+
+#include <arpa/inet.h>
+#include <iostream>
+#include <netinet/in.h>
+#include <poll.h>
+#include <random>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+// Longest handshake line accepted.
+static const size_t kHandshakeMaxLength = 256;
+
+std::string connection_handshake_format(const ConnectionHandshake &handshake) {
+  return handshake.id + " " + std::to_string(handshake.buffer_size) + " " +
+    std::to_string(handshake.num_lanes) + "\n";
+}
+
+bool connection_handshake_read(const int fd, ConnectionHandshake *handshake) {
+  std::string resp;
+  char c;
+  while (true) {
+    if (recv(fd, &c, 1, 0) != 1 || resp.size() == kHandshakeMaxLength) {
+      return false;
+    }
+    if (c == '\n') {
+      break;
+    }
+    resp.push_back(c);
+  }
+
+  size_t sep_index = resp.find(' ');
+  if (std::string::npos == sep_index) {
+    return false;
+  }
+
+  handshake->id = resp.substr(0, sep_index);
+  handshake->num_lanes = 1;
+
+  try {
+    const std::string sizes_str = resp.substr(sep_index + 1);
+    size_t lanes_index;
+    handshake->buffer_size = std::stoi(sizes_str, &lanes_index);
+    if (lanes_index < sizes_str.size()) {
+      handshake->num_lanes = std::stoi(sizes_str.substr(lanes_index));
+    }
+  } catch (...) {
+    return false;
+  }
+
+  return handshake->buffer_size > 0;
+}
+
+std::string connection_next_id() {
+  static const char alphabet[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789";
+  thread_local std::random_device rnd_device;
+
+  char id[32];
+  std::uniform_int_distribution<int> dist(0, sizeof(alphabet) - 2);
+  for (int i=0; i<32; i++) {
+    id[i] = alphabet[dist(rnd_device)];
+  }
+  return std::string(id, 32);
+}
+
+int connection_listen(const int port) {
+  const int server_fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (server_fd < 0) {
+    return -1;
+  }
+
+  int opt = 1;
+  if (setsockopt(server_fd, SOL_SOCKET, SO_REUSEADDR | SO_REUSEPORT, &opt, sizeof(opt))) {
+    close(server_fd);
+    return -1;
+  }
+
+  struct sockaddr_in address;
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = INADDR_ANY;
+  address.sin_port = htons(port);
+
+  if (bind(server_fd, (struct sockaddr *)&address, sizeof(address)) < 0 ||
+      listen(server_fd, 3) < 0) {
+    close(server_fd);
+    return -1;
+  }
+
+  return server_fd;
+}
+
+int connection_connect(const char *host, const int port) {
+  const int client_fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (client_fd < 0) {
+    return -1;
+  }
+
+  struct sockaddr_in address;
+  address.sin_family = AF_INET;
+  address.sin_port = htons(port);
+
+  if (inet_pton(AF_INET, host, &address.sin_addr) <= 0 ||
+      connect(client_fd, (struct sockaddr *)&address, sizeof(address)) < 0) {
+    close(client_fd);
+    return -1;
+  }
+
+  return client_fd;
+}
+
+void connection_serve(
+    const int server_fd, const std::atomic<bool> &running,
+    const std::function<bool(int)> &on_accept, const std::function<void(int)> &on_disconnect) {
+  std::vector<struct pollfd> poll_set(1);
+  poll_set[0].fd = server_fd;
+  poll_set[0].events = POLLIN;
+
+  while (running) {
+    if (poll(poll_set.data(), poll_set.size(), 1000) <= 0) {
+      continue;
+    }
+
+    std::vector<int> disconnected;
+
+    const int num_fds = poll_set.size();
+    for (int i=0; i<num_fds; i++) {
+      const auto polled_fd = poll_set[i];
+
+      if (!(polled_fd.revents & (POLLIN | POLLHUP | POLLERR))) {
+        continue;
+      }
+
+      if (polled_fd.fd == server_fd) {
+        // handle new connection
+        struct sockaddr_in address;
+        socklen_t addrlen = sizeof(address);
+        const int new_socket = accept(server_fd, (struct sockaddr *)&address, &addrlen);
+        if (new_socket < 0) {
+          std::cerr << "could not open new connection" << std::endl;
+          continue;
+        }
+
+        if (on_accept(new_socket)) {
+          poll_set.emplace_back();
+          poll_set.back().fd = new_socket;
+          poll_set.back().events = POLLIN;
+        }
+
+      } else {
+        // handle client request: should never send data so we will always
+        // just close the socket here.
+        on_disconnect(polled_fd.fd);
+        close(polled_fd.fd);
+        disconnected.push_back(i);
+      }
+    }
+
+    // Remove from the back, so the indices still to be removed stay valid.
+    for (auto it = disconnected.rbegin(); it != disconnected.rend(); ++it) {
+      poll_set[*it] = poll_set.back();
+      poll_set.pop_back();
+    }
+  }
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <string>
+
+// First line a server sends to a new connection: "<id> <buffer_size> <num_lanes>\n". The id
+// names the connection's shared memory region, or the protocol for the bridge. Servers
+// without lanes may omit num_lanes, which then reads as 1.
+struct ConnectionHandshake {
+  std::string id;
+  int buffer_size;
+  int num_lanes;
+};
+
+std::string connection_handshake_format(const ConnectionHandshake &handshake);
+
+// Read the handshake a byte at a time, so nothing sent after it is consumed. Returns false if
+// the connection closed or the line is malformed.
+bool connection_handshake_read(const int fd, ConnectionHandshake *handshake);
+
+// A random 32 character alphanumeric id, used to name a connection's shared memory region.
+std::string connection_next_id();
+
+// Create a tcp socket listening on port on all interfaces. Returns the fd, or -1.
+int connection_listen(const int port);
+
+// Connect a tcp socket to the IPv4 address host. Returns the fd, or -1.
+int connection_connect(const char *host, const int port);
+
+// Accept connections on server_fd until running is false. on_accept returns true to have the
+// connection watched: clients never send data, so once it becomes readable on_disconnect is
+// called and the fd closed. Otherwise on_accept has closed or taken over the fd.
+void connection_serve(
+  const int server_fd, const std::atomic<bool> &running,
+  const std::function<bool(int)> &on_accept, const std::function<void(int)> &on_disconnect);
@@ -8,29 +8,44 @@
 #include <functional>
 #include <iostream>
 #include <mutex>
-#include <netinet/in.h>
-#include <poll.h>
 #include <queue>
-#include <random>
 #include <stdlib.h>
 #include <string.h>
-#include <sys/ioctl.h>
 #include <sys/socket.h>
 #include <thread>
 #include <unistd.h>
 #include <unordered_map>
 #include <utility>
+#include <vector>
 
+#include "connection.h"
 #include "sharedmem.h"
+#include "thread_attr.h"
+#include "trace.h"
+
+static_assert(PUB_SLOT_ALIGN == kSlotAlignment, "public slot alignment out of sync");
+static_assert(PUB_MAX_LANES == kMaxLanes, "public lane count out of sync");
+
+struct publish_request_t {
+  const void *data;
+  size_t length;
+  unsigned long tag;
+  unsigned long sequence;
+  long publish_ns;
+  int lane;
+  bool loaned;
+};
 
 struct client_t {
-  client_t(const std::string herald_id, const int buffer_size)
+  client_t(const std::string herald_id, const int buffer_size, const int num_lanes)
     : _herald_id(herald_id)
-    , _buffer_size(buffer_size) {
+    , _buffer_size(buffer_size)
+    , _num_lanes(num_lanes)
+    , _shared_mem(nullptr) {
   }
 
   bool init() {
-    SharedMem *shared_mem = sharedmem_create(_herald_id, _buffer_size, true);
+    SharedMem *shared_mem = sharedmem_create(_herald_id, _buffer_size, _num_lanes, true);
     if (shared_mem != nullptr) {
       _shared_mem = shared_mem;
       return true;
@@ -39,21 +54,34 @@ struct client_t {
     }
   }
 
-  void write(const void *data, const size_t length) {
-    const int read_idx = _shared_mem->header->read_idx;
-    const int write_idx = _shared_mem->header->write_idx;
+  bool matches(const unsigned long tag) const {
+    return 0 != (tag & __atomic_load_n(&_shared_mem->header->filter, __ATOMIC_ACQUIRE));
+  }
+
+  void write(const publish_request_t &req, const int port) {
+    SharedMemLane *lane = &_shared_mem->header->lanes[req.lane];
+    const int read_idx = lane->read_idx;
+    const int write_idx = lane->write_idx;
     const int new_write_idx =
       (read_idx != 0 && write_idx != 0) ? 0 :
       (read_idx != 1 && write_idx != 1) ? 1 :
       2;
 
-    uint8_t *write_buffer = _shared_mem->buffers[new_write_idx];
-    memcpy(write_buffer, data, length);
-    _shared_mem->header->lengths[new_write_idx] = length;
+    uint8_t *write_buffer = _shared_mem->buffers[req.lane][new_write_idx];
+    memcpy(write_buffer, req.data, req.length);
+    lane->lengths[new_write_idx] = req.length;
+
+    const long write_ns = trace_now_ns();
+    lane->sequences[new_write_idx] = req.sequence;
+    lane->tags[new_write_idx] = req.tag;
+    lane->publish_ns[new_write_idx] = req.publish_ns;
+    lane->write_ns[new_write_idx] = write_ns;
+    trace_record(TRACE_WRITE, port, req.lane, req.sequence, write_ns);
 
     pthread_mutex_lock(&_shared_mem->header->mutex);
 
-    _shared_mem->header->write_idx = new_write_idx;
+    lane->write_idx = new_write_idx;
+    lane->generation++;
     _shared_mem->header->generation++;
     pthread_cond_signal(&_shared_mem->header->cond);
 
@@ -68,17 +96,24 @@ struct client_t {
 
   const std::string _herald_id;
   const int _buffer_size;
+  const int _num_lanes;
   SharedMem *_shared_mem;
 };
 
 struct publisher_t {
-  publisher_t(const int port, const size_t buffer_size);
+  publisher_t(const int port, const size_t buffer_size, const publisher_attr_t &attr);
   ~publisher_t();
 
   publisher_error init();
-  publisher_error publish(const void *data, const size_t length);
+  publisher_error publish(
+    const void *data, const size_t length, const unsigned long tag, const int lane,
+    const bool loaned);
+
+  void *loan();
+  void return_loan(void *loan);
 
-  std::string get_next_id();
+  bool accept_client(const int fd);
+  void remove_client(const int fd);
 
   // Thread functions
   void thread_server();
@@ -87,6 +122,9 @@ struct publisher_t {
   // Members
   const int _port;
   const int _buffer_size;
+  const int _num_lanes;
+  const ThreadAttr _server_thread_attr;
+  const ThreadAttr _publish_thread_attr;
 
   std::atomic<bool> _running;
   std::thread _server_thread;
@@ -94,9 +132,15 @@ struct publisher_t {
 
   std::mutex _publish_mutex;
   std::condition_variable _publish_cv;
-  std::queue<std::pair<const void*, size_t>> _publish_pending;
-  std::vector<char> _id_alphabet;
-  std::random_device _rnd_device;
+  // One queue per priority lane, drained highest lane first.
+  std::vector<std::queue<publish_request_t>> _publish_pending;
+  size_t _publish_queued;
+  // Sequences are per lane, so each lane is consecutive even though lanes overtake each other.
+  unsigned long _next_sequence[PUB_MAX_LANES];
+
+  std::mutex _loan_mutex;
+  std::vector<void*> _loans_free;
+  std::vector<void*> _loans_all;
 
   int _server_fd;
   std::mutex _client_mutex;
@@ -106,8 +150,23 @@ struct publisher_t {
 // API functions
 // --------------------------------------------------
 
+void publisher_attr_init(publisher_attr_t *attr) {
+  herald_thread_attr_init(&attr->server_thread);
+  herald_thread_attr_init(&attr->publish_thread);
+  attr->num_lanes = 1;
+}
+
 publisher_t *publisher_create(const int port, const size_t buffer_size) {
-  return new publisher_t(port, buffer_size);
+  publisher_attr_t attr;
+  publisher_attr_init(&attr);
+  return new publisher_t(port, buffer_size, attr);
+}
+
+publisher_t *publisher_create_with_attr(
+    const int port, const size_t buffer_size, const publisher_attr_t *attr) {
+  publisher_attr_t default_attr;
+  publisher_attr_init(&default_attr);
+  return new publisher_t(port, buffer_size, attr != nullptr ? *attr : default_attr);
 }
 
 publisher_error publisher_init(publisher_t *publisher) {
@@ -115,7 +174,41 @@ publisher_error publisher_init(publisher_t *publisher) {
 }
 
 publisher_error publisher_publish(publisher_t *publisher, const void* data, const size_t length) {
-  publisher->publish(data, length);
+  return publisher->publish(data, length, PUB_TAG_ALL, 0, false);
+}
+
+publisher_error publisher_publish_tagged(
+    publisher_t *publisher, const void* data, const size_t length, const unsigned long tag) {
+  return publisher->publish(data, length, tag, 0, false);
+}
+
+publisher_error publisher_publish_lane(
+    publisher_t *publisher, const void* data, const size_t length, const unsigned long tag,
+    const int lane) {
+  return publisher->publish(data, length, tag, lane, false);
+}
+
+size_t publisher_buffer_size(publisher_t *publisher) {
+  return publisher->_buffer_size;
+}
+
+void *publisher_loan(publisher_t *publisher) {
+  return publisher->loan();
+}
+
+publisher_error publisher_publish_loan(
+    publisher_t *publisher, void *loan, const size_t length, const unsigned long tag) {
+  return publisher->publish(loan, length, tag, 0, true);
+}
+
+publisher_error publisher_publish_loan_lane(
+    publisher_t *publisher, void *loan, const size_t length, const unsigned long tag,
+    const int lane) {
+  return publisher->publish(loan, length, tag, lane, true);
+}
+
+void publisher_return_loan(publisher_t *publisher, void *loan) {
+  publisher->return_loan(loan);
 }
 
 void publisher_destroy(publisher_t *publisher) {
@@ -125,16 +218,17 @@ void publisher_destroy(publisher_t *publisher) {
 // Implementation
 // --------------------------------------------------
 
-publisher_t::publisher_t(const int port, const size_t buffer_size)
+publisher_t::publisher_t(const int port, const size_t buffer_size, const publisher_attr_t &attr)
   : _port(port)
   , _buffer_size(buffer_size)
+  , _num_lanes(attr.num_lanes)
+  , _server_thread_attr(attr.server_thread)
+  , _publish_thread_attr(attr.publish_thread)
   , _running(false)
-  , _server_fd(-1) {
-
-  for (char c = 'A'; c <= 'Z'; c++) _id_alphabet.push_back(c);
-  for (char c = 'a'; c <= 'z'; c++) _id_alphabet.push_back(c);
-  for (char c = '0'; c <= '9'; c++) _id_alphabet.push_back(c);
-}
+  , _publish_pending(std::max(1, std::min(attr.num_lanes, PUB_MAX_LANES)))
+  , _publish_queued(0)
+  , _next_sequence()
+  , _server_fd(-1) {}
 
 publisher_t::~publisher_t() {
   if (_running) {
@@ -143,154 +237,171 @@ publisher_t::~publisher_t() {
     _publish_thread.join();
   }
 
+  for (const auto &client : _clients) {
+    close(client.first);
+  }
+
   if (_server_fd != -1) {
     close(_server_fd);
   }
+
+  for (void *loan : _loans_all) {
+    free(loan);
+  }
 }
 
 publisher_error publisher_t::init() {
-  if ((_server_fd = socket(AF_INET, SOCK_STREAM, 0)) == 0) {
-    return PUB_NOSOCKET;
+  if (_num_lanes < 1 || _num_lanes > PUB_MAX_LANES) {
+    return PUB_BADLANE;
   }
 
-  int opt = 1;
-  if (setsockopt(_server_fd, SOL_SOCKET, SO_REUSEADDR | SO_REUSEPORT, &opt, sizeof(opt))) {
+  if ((_server_fd = connection_listen(_port)) == -1) {
     return PUB_NOSOCKET;
   }
 
-  struct sockaddr_in address;
-  address.sin_family = AF_INET;
-  address.sin_addr.s_addr = INADDR_ANY;
-  address.sin_port = htons(_port);
-
-  if (bind(_server_fd, (struct sockaddr *)&address, sizeof(address)) < 0) {
-    return PUB_NOSOCKET;
+  _running = true;
+  if (!thread_attr_start(
+        _server_thread, _server_thread_attr, std::bind(&publisher_t::thread_server, this))) {
+    _running = false;
+    close(_server_fd);
+    _server_fd = -1;
+    return PUB_NOTHREADATTR;
   }
 
-  if (listen(_server_fd, 3) < 0) {
-    return PUB_NOSOCKET;
+  if (!thread_attr_start(
+        _publish_thread, _publish_thread_attr, std::bind(&publisher_t::thread_publish, this))) {
+    _running = false;
+    _server_thread.join();
+    close(_server_fd);
+    _server_fd = -1;
+    return PUB_NOTHREADATTR;
   }
 
-  _running = true;
-  _server_thread = std::thread(std::bind(&publisher_t::thread_server, this));
-  _publish_thread = std::thread(std::bind(&publisher_t::thread_publish, this));
   return PUB_OK;
 }
 
-publisher_error publisher_t::publish(const void* data, const size_t length) {
+publisher_error publisher_t::publish(
+    const void* data, const size_t length, const unsigned long tag, const int lane,
+    const bool loaned) {
   if (!_running) {
+    if (loaned) return_loan(const_cast<void*>(data));
     return PUB_NOTRUNNING;
   }
 
+  if (lane < 0 || lane >= _num_lanes) {
+    if (loaned) return_loan(const_cast<void*>(data));
+    return PUB_BADLANE;
+  }
+
   if (length > _buffer_size) {
+    if (loaned) return_loan(const_cast<void*>(data));
     return PUB_TOOLARGE;
   }
 
   {
     std::unique_lock<std::mutex> lock(_publish_mutex);
-    _publish_pending.push(std::make_pair(data, length));
+    const unsigned long sequence = _next_sequence[lane]++;
+    const long publish_ns = trace_now_ns();
+    _publish_pending[lane].push(
+      publish_request_t{data, length, tag, sequence, publish_ns, lane, loaned});
+    _publish_queued++;
+    trace_record(TRACE_PUBLISH, _port, lane, sequence, publish_ns);
     _publish_cv.notify_one();
   }
 
   return PUB_OK;
 }
 
-std::string publisher_t::get_next_id() {
-  char id[32];
-  std::uniform_int_distribution<int> dist(0, _id_alphabet.size() - 1);
-  for (int i=0; i<32; i++) {
-    id[i] = _id_alphabet[dist(_rnd_device)];
+void *publisher_t::loan() {
+  std::unique_lock<std::mutex> lock(_loan_mutex);
+  if (!_loans_free.empty()) {
+    void *loan = _loans_free.back();
+    _loans_free.pop_back();
+    return loan;
   }
-  return std::string(id, 32);
-}
-
-void publisher_t::thread_server() {
-  std::vector<struct pollfd> poll_set(1);
-  poll_set[0].fd = _server_fd;
-  poll_set[0].events = POLLIN;
 
-  while (_running) {
-    poll(poll_set.data(), poll_set.size(), 1000);
-
-    std::vector<int> disconnected;
-
-    const int num_fds = poll_set.size();
-    for (int i=0; i<num_fds; i++) {
-      const auto polled_fd = poll_set[i];
-
-      if(!(polled_fd.revents & POLLIN)) {
-        continue;
-      }
+  void *loan;
+  if (0 != posix_memalign(&loan, kSlotAlignment, slot_align(_buffer_size))) {
+    return nullptr;
+  }
 
-      if (polled_fd.fd == _server_fd) {
-        // handle new connection
-        struct sockaddr_in address;
-        int addrlen = sizeof(address);
-        int new_socket;
-        if ((new_socket = accept(_server_fd, (struct sockaddr *)&address,
-                                 (socklen_t*)&addrlen)) < 0) {
-          std::cerr << "could not open new connection" << std::endl;
-          continue;
-        }
+  _loans_all.push_back(loan);
+  return loan;
+}
 
-        const std::string herald_id = get_next_id();
+void publisher_t::return_loan(void *loan) {
+  std::unique_lock<std::mutex> lock(_loan_mutex);
+  _loans_free.push_back(loan);
+}
 
-        std::shared_ptr<client_t> new_client = std::make_shared<client_t>(herald_id, _buffer_size);
-        if (!new_client->init()) {
-          std::cerr << "error initializing client in publisher" << std::endl;
-          close(new_socket);
-          continue;
-        }
+bool publisher_t::accept_client(const int fd) {
+  const std::string herald_id = connection_next_id();
 
-        {
-          std::unique_lock<std::mutex> client_lock(_client_mutex);
-          _clients[new_socket] = new_client;
-        }
+  std::shared_ptr<client_t> new_client = std::make_shared<client_t>(
+    herald_id, _buffer_size, _num_lanes);
+  if (!new_client->init()) {
+    std::cerr << "error initializing client in publisher" << std::endl;
+    close(fd);
+    return false;
+  }
 
-        const std::string open_resp = herald_id + " " + std::to_string(_buffer_size) + "\n";
-        send(new_socket, open_resp.c_str(), open_resp.size(), 0);
+  {
+    std::unique_lock<std::mutex> client_lock(_client_mutex);
+    _clients[fd] = new_client;
+  }
 
-        poll_set.emplace_back();
-        poll_set.back().fd = new_socket;
-        poll_set.back().events = POLLIN;
+  const std::string open_resp = connection_handshake_format(
+    ConnectionHandshake{herald_id, _buffer_size, _num_lanes});
+  send(fd, open_resp.c_str(), open_resp.size(), MSG_NOSIGNAL);
+  return true;
+}
 
-      } else {
-        // handle client request: should never send data so we will always
-        // just close the socket here.
-        close(polled_fd.fd);
-        _clients.erase(polled_fd.fd);
-        disconnected.push_back(i);
-      }
-    }
+void publisher_t::remove_client(const int fd) {
+  std::unique_lock<std::mutex> client_lock(_client_mutex);
+  _clients.erase(fd);
+}
 
-    for (const int i : disconnected) {
-      poll_set[i] = poll_set.back();
-      poll_set.pop_back();
-    }
-  }
+void publisher_t::thread_server() {
+  connection_serve(
+    _server_fd, _running,
+    std::bind(&publisher_t::accept_client, this, std::placeholders::_1),
+    std::bind(&publisher_t::remove_client, this, std::placeholders::_1));
 }
 
 void publisher_t::thread_publish() {
   while (_running) {
-    std::pair<const void*, size_t> publish_req;
+    publish_request_t publish_req;
     {
       std::unique_lock<std::mutex> lock(_publish_mutex);
       bool have_request = _publish_cv.wait_for(
-        lock, std::chrono::milliseconds(100), [this] { return !_publish_pending.empty();});
+        lock, std::chrono::milliseconds(100), [this] { return _publish_queued != 0;});
 
       if (!have_request) {
         continue;
       }
 
-      publish_req = _publish_pending.front();
-      _publish_pending.pop();
+      // Re-checked after every message, so urgent messages overtake a backlog of bulk ones.
+      int lane = _num_lanes - 1;
+      while (_publish_pending[lane].empty()) {
+        lane--;
+      }
+
+      publish_req = _publish_pending[lane].front();
+      _publish_pending[lane].pop();
+      _publish_queued--;
     }
 
     {
       std::unique_lock<std::mutex> client_lock(_client_mutex);
-      for (const auto client : _clients) {
-        client.second->write(publish_req.first, publish_req.second);
+      for (const auto &client : _clients) {
+        if (client.second->matches(publish_req.tag)) {
+          client.second->write(publish_req, _port);
+        }
       }
     }
+
+    if (publish_req.loaned) {
+      return_loan(const_cast<void*>(publish_req.data));
+    }
   }
 }
@@ -0,0 +1,236 @@
+#include <herald/rpc_client.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <string.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+#include "connection.h"
+#include "sharedmem.h"
+
+struct rpc_client_t {
+  rpc_client_t(const int port);
+  ~rpc_client_t();
+
+  rpc_client_error init();
+  rpc_client_error call(
+    const void *request, const size_t request_len,
+    void *reply, const size_t reply_capacity, size_t *reply_len, const int timeout_ms);
+  rpc_client_error call_async(
+    const void *request, const size_t request_len,
+    const rpc_reply_callback_t callback, unsigned long *call_id);
+
+  rpc_client_error send_request(
+    const void *request, const size_t request_len, unsigned long *call_id);
+
+  void thread_reply();
+
+  // members
+  const int _port;
+
+  int _client_fd;
+  RpcSharedMem *_shared_mem;
+
+  // Serializes callers; each client has a single request slot.
+  std::mutex _call_mutex;
+  unsigned long _last_call_id;
+
+  std::mutex _async_mutex;
+  std::condition_variable _async_cv;
+  bool _async_pending;
+  unsigned long _async_call_id;
+  rpc_reply_callback_t _async_callback;
+
+  std::atomic<bool> _running;
+  std::thread _reply_thread;
+};
+
+// API functions
+// --------------------------------------------------
+
+rpc_client_t *rpc_client_create(const int port) {
+  return new rpc_client_t(port);
+}
+
+void rpc_client_destroy(rpc_client_t *client) {
+  delete client;
+}
+
+rpc_client_error rpc_client_init(rpc_client_t *client) {
+  return client->init();
+}
+
+rpc_client_error rpc_client_call(
+    rpc_client_t *client, const void *request, const size_t request_len,
+    void *reply, const size_t reply_capacity, size_t *reply_len, const int timeout_ms) {
+  return client->call(request, request_len, reply, reply_capacity, reply_len, timeout_ms);
+}
+
+rpc_client_error rpc_client_call_async(
+    rpc_client_t *client, const void *request, const size_t request_len,
+    const rpc_reply_callback_t callback, unsigned long *call_id) {
+  return client->call_async(request, request_len, callback, call_id);
+}
+
+// Implementation
+// --------------------------------------------------
+
+rpc_client_t::rpc_client_t(const int port)
+  : _port(port)
+  , _client_fd(-1)
+  , _shared_mem(nullptr)
+  , _last_call_id(0)
+  , _async_pending(false)
+  , _async_call_id(0)
+  , _async_callback(nullptr)
+  , _running(false) {}
+
+rpc_client_t::~rpc_client_t() {
+  if (_running) {
+    _running = false;
+    _reply_thread.join();
+  }
+
+  if (_client_fd != -1) {
+    close(_client_fd);
+  }
+
+  if (_shared_mem != nullptr) {
+    rpc_sharedmem_destroy(_shared_mem);
+  }
+}
+
+rpc_client_error rpc_client_t::init() {
+  if ((_client_fd = connection_connect("127.0.0.1", _port)) == -1) {
+    return RPC_CLIENT_NOSOCKET;
+  }
+
+  ConnectionHandshake handshake;
+  if (!connection_handshake_read(_client_fd, &handshake)) {
+    return RPC_CLIENT_BADRESP;
+  }
+
+  _shared_mem = rpc_sharedmem_create(handshake.id, handshake.buffer_size, false);
+  if (_shared_mem == nullptr) {
+    return RPC_CLIENT_NOSHAREDMEM;
+  }
+
+  _running = true;
+  _reply_thread = std::thread(std::bind(&rpc_client_t::thread_reply, this));
+
+  return RPC_CLIENT_OK;
+}
+
+rpc_client_error rpc_client_t::send_request(
+    const void *request, const size_t request_len, unsigned long *call_id) {
+  if (!_running) {
+    return RPC_CLIENT_NOTRUNNING;
+  }
+
+  if (request_len > (size_t) _shared_mem->buffer_size) {
+    return RPC_CLIENT_TOOLARGE;
+  }
+
+  // The server may still be working on a call that previously timed out.
+  if (__atomic_load_n(&_shared_mem->header->reply_id, __ATOMIC_ACQUIRE) != _last_call_id) {
+    return RPC_CLIENT_BUSY;
+  }
+
+  memcpy(_shared_mem->request_buffer, request, request_len);
+  _shared_mem->header->request_length = request_len;
+
+  *call_id = ++_last_call_id;
+  rpc_sharedmem_post_request(_shared_mem, *call_id);
+  return RPC_CLIENT_OK;
+}
+
+rpc_client_error rpc_client_t::call(
+    const void *request, const size_t request_len,
+    void *reply, const size_t reply_capacity, size_t *reply_len, const int timeout_ms) {
+  std::unique_lock<std::mutex> call_lock(_call_mutex);
+
+  {
+    std::unique_lock<std::mutex> async_lock(_async_mutex);
+    if (_async_pending) {
+      return RPC_CLIENT_BUSY;
+    }
+  }
+
+  unsigned long call_id;
+  const rpc_client_error err = send_request(request, request_len, &call_id);
+  if (err != RPC_CLIENT_OK) {
+    return err;
+  }
+
+  if (!rpc_sharedmem_wait_reply(_shared_mem, call_id, timeout_ms)) {
+    return RPC_CLIENT_TIMEOUT;
+  }
+
+  const size_t length = _shared_mem->header->reply_length;
+  *reply_len = length;
+  if (length > reply_capacity) {
+    return RPC_CLIENT_TOOLARGE;
+  }
+
+  memcpy(reply, _shared_mem->reply_buffer, length);
+  return RPC_CLIENT_OK;
+}
+
+rpc_client_error rpc_client_t::call_async(
+    const void *request, const size_t request_len,
+    const rpc_reply_callback_t callback, unsigned long *call_id) {
+  std::unique_lock<std::mutex> call_lock(_call_mutex);
+  std::unique_lock<std::mutex> async_lock(_async_mutex);
+
+  if (_async_pending) {
+    return RPC_CLIENT_BUSY;
+  }
+
+  const rpc_client_error err = send_request(request, request_len, call_id);
+  if (err != RPC_CLIENT_OK) {
+    return err;
+  }
+
+  _async_pending = true;
+  _async_call_id = *call_id;
+  _async_callback = callback;
+  _async_cv.notify_one();
+
+  return RPC_CLIENT_OK;
+}
+
+void rpc_client_t::thread_reply() {
+  while (_running) {
+    unsigned long call_id;
+    rpc_reply_callback_t callback;
+    {
+      std::unique_lock<std::mutex> lock(_async_mutex);
+      bool have_call = _async_cv.wait_for(
+        lock, std::chrono::milliseconds(100), [this] { return _async_pending; });
+
+      if (!have_call) {
+        continue;
+      }
+
+      call_id = _async_call_id;
+      callback = _async_callback;
+    }
+
+    if (!rpc_sharedmem_wait_reply(_shared_mem, call_id, 1000)) {
+      continue;
+    }
+
+    callback(call_id, _shared_mem->reply_buffer, _shared_mem->header->reply_length);
+
+    {
+      std::unique_lock<std::mutex> lock(_async_mutex);
+      _async_pending = false;
+    }
+  }
+}
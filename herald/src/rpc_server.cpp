@@ -0,0 +1,191 @@
+#include <herald/rpc_server.h>
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <unordered_map>
+#include <vector>
+
+#include "connection.h"
+#include "sharedmem.h"
+
+struct rpc_connection_t {
+  rpc_connection_t(const std::string herald_id, const int buffer_size, const rpc_handler_t handler)
+    : _herald_id(herald_id)
+    , _buffer_size(buffer_size)
+    , _handler(handler)
+    , _shared_mem(nullptr)
+    , _running(false) {
+  }
+
+  bool init() {
+    RpcSharedMem *shared_mem = rpc_sharedmem_create(_herald_id, _buffer_size, true);
+    if (shared_mem == nullptr) {
+      return false;
+    }
+
+    _shared_mem = shared_mem;
+    _running = true;
+    _worker_thread = std::thread(std::bind(&rpc_connection_t::thread_worker, this));
+    return true;
+  }
+
+  void thread_worker() {
+    RpcSharedMemHeader *header = _shared_mem->header;
+
+    while (_running) {
+      if (!rpc_sharedmem_wait_request(_shared_mem, 1000)) {
+        continue;
+      }
+
+      const unsigned long call_id = __atomic_load_n(&header->request_id, __ATOMIC_ACQUIRE);
+      size_t reply_length = _handler(
+        _shared_mem->request_buffer, header->request_length,
+        _shared_mem->reply_buffer, _buffer_size);
+
+      header->reply_length = std::min(reply_length, (size_t) _buffer_size);
+      rpc_sharedmem_post_reply(_shared_mem, call_id);
+    }
+  }
+
+  ~rpc_connection_t() {
+    if (_running) {
+      _running = false;
+      _worker_thread.join();
+    }
+
+    if (_shared_mem != nullptr) {
+      rpc_sharedmem_destroy(_shared_mem);
+    }
+  }
+
+  const std::string _herald_id;
+  const int _buffer_size;
+  const rpc_handler_t _handler;
+  RpcSharedMem *_shared_mem;
+
+  std::atomic<bool> _running;
+  std::thread _worker_thread;
+};
+
+struct rpc_server_t {
+  rpc_server_t(const int port, const size_t buffer_size, const rpc_handler_t handler);
+  ~rpc_server_t();
+
+  rpc_server_error init();
+
+  bool accept_connection(const int fd);
+  void remove_connection(const int fd);
+
+  // Thread functions
+  void thread_server();
+
+  // Members
+  const int _port;
+  const int _buffer_size;
+  const rpc_handler_t _handler;
+
+  std::atomic<bool> _running;
+  std::thread _server_thread;
+
+  int _server_fd;
+  std::mutex _connection_mutex;
+  std::unordered_map<int, std::shared_ptr<rpc_connection_t>> _connections;
+};
+
+// API functions
+// --------------------------------------------------
+
+rpc_server_t *rpc_server_create(
+    const int port, const size_t buffer_size, const rpc_handler_t handler) {
+  return new rpc_server_t(port, buffer_size, handler);
+}
+
+rpc_server_error rpc_server_init(rpc_server_t *server) {
+  return server->init();
+}
+
+void rpc_server_destroy(rpc_server_t *server) {
+  delete server;
+}
+
+// Implementation
+// --------------------------------------------------
+
+rpc_server_t::rpc_server_t(const int port, const size_t buffer_size, const rpc_handler_t handler)
+  : _port(port)
+  , _buffer_size(buffer_size)
+  , _handler(handler)
+  , _running(false)
+  , _server_fd(-1) {}
+
+rpc_server_t::~rpc_server_t() {
+  if (_running) {
+    _running = false;
+    _server_thread.join();
+  }
+
+  {
+    std::unique_lock<std::mutex> connection_lock(_connection_mutex);
+    for (const auto &connection : _connections) {
+      close(connection.first);
+    }
+    _connections.clear();
+  }
+
+  if (_server_fd != -1) {
+    close(_server_fd);
+  }
+}
+
+rpc_server_error rpc_server_t::init() {
+  if ((_server_fd = connection_listen(_port)) == -1) {
+    return RPC_SERVER_NOSOCKET;
+  }
+
+  _running = true;
+  _server_thread = std::thread(std::bind(&rpc_server_t::thread_server, this));
+  return RPC_SERVER_OK;
+}
+
+bool rpc_server_t::accept_connection(const int fd) {
+  const std::string herald_id = connection_next_id();
+
+  std::shared_ptr<rpc_connection_t> new_connection =
+    std::make_shared<rpc_connection_t>(herald_id, _buffer_size, _handler);
+  if (!new_connection->init()) {
+    std::cerr << "error initializing connection in rpc server" << std::endl;
+    close(fd);
+    return false;
+  }
+
+  {
+    std::unique_lock<std::mutex> connection_lock(_connection_mutex);
+    _connections[fd] = new_connection;
+  }
+
+  const std::string open_resp = connection_handshake_format(
+    ConnectionHandshake{herald_id, _buffer_size, 1});
+  send(fd, open_resp.c_str(), open_resp.size(), MSG_NOSIGNAL);
+  return true;
+}
+
+void rpc_server_t::remove_connection(const int fd) {
+  std::unique_lock<std::mutex> connection_lock(_connection_mutex);
+  _connections.erase(fd);
+}
+
+void rpc_server_t::thread_server() {
+  connection_serve(
+    _server_fd, _running,
+    std::bind(&rpc_server_t::accept_connection, this, std::placeholders::_1),
+    std::bind(&rpc_server_t::remove_connection, this, std::placeholders::_1));
+}
@@ -4,9 +4,13 @@
 #include <fcntl.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
+#include <thread>
+#include <time.h>
 #include <unistd.h>
 
-SharedMem *sharedmem_create(const std::string shm_name, const int buffer_size, const bool create) {
+// Open (and optionally create) the named shared memory region and map it. The fd is closed
+// once mapped, the mapping keeps the region alive.
+static uint8_t *shm_map(const std::string &shm_name, const int shm_size, const bool create) {
   int oflag = O_RDWR;
   if (create) oflag |= O_CREAT;
 
@@ -15,89 +19,262 @@ SharedMem *sharedmem_create(const std::string shm_name, const int buffer_size, c
     return nullptr;
   }
 
-  const int shm_size = sizeof(SharedMemHeader) + 3 * buffer_size;
-
   if (create) {
     if (0 != ftruncate(shm_fd, shm_size)) {
+      close(shm_fd);
       shm_unlink(shm_name.c_str());
       return nullptr;
     }
   }
 
   uint8_t *shm = (uint8_t*) mmap(nullptr, shm_size, PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd, 0);
+  close(shm_fd);
   if (MAP_FAILED == shm) {
     shm_unlink(shm_name.c_str());
     return nullptr;
   }
 
+  return shm;
+}
+
+static bool shm_mutex_init(pthread_mutex_t *mutex) {
+  pthread_mutexattr_t mutex_attr;
+  if (0 != pthread_mutexattr_init(&mutex_attr)) {
+    return false;
+  }
+
+  if (0 != pthread_mutexattr_setpshared(&mutex_attr, PTHREAD_PROCESS_SHARED)) {
+    return false;
+  }
+
+  return 0 == pthread_mutex_init(mutex, &mutex_attr);
+}
+
+static bool shm_cond_init(pthread_cond_t *cond) {
+  pthread_condattr_t cond_attr;
+  if (0 != pthread_condattr_init(&cond_attr)) {
+    return false;
+  }
+
+  if (0 != pthread_condattr_setpshared(&cond_attr, PTHREAD_PROCESS_SHARED)) {
+    return false;
+  }
+
+  return 0 == pthread_cond_init(cond, &cond_attr);
+}
+
+SharedMem *sharedmem_create(
+    const std::string shm_name, const int buffer_size, const int num_lanes, const bool create) {
+  if (num_lanes < 1 || num_lanes > kMaxLanes) {
+    return nullptr;
+  }
+
+  const int header_size = slot_align(sizeof(SharedMemHeader));
+  const int slot_size = slot_align(buffer_size);
+  const int shm_size = header_size + num_lanes * 3 * slot_size;
+
+  uint8_t *shm = shm_map(shm_name, shm_size, create);
+  if (nullptr == shm) {
+    return nullptr;
+  }
+
   SharedMem *shared_mem = new SharedMem;
   shared_mem->shm_name = shm_name;
   shared_mem->buffer_size = buffer_size;
-  shared_mem->shm_fd = shm_fd;
+  shared_mem->num_lanes = num_lanes;
   shared_mem->shm = shm;
   shared_mem->shm_size = shm_size;
   shared_mem->owned = create;
   shared_mem->header = (SharedMemHeader*) shm;
-  shared_mem->buffers[0] = shm + sizeof(SharedMemHeader);
-  shared_mem->buffers[1] = shm + (sizeof(SharedMemHeader) * 2);
-  shared_mem->buffers[2] = shm + (sizeof(SharedMemHeader) * 3);
+  for (int lane=0; lane<num_lanes; lane++) {
+    for (int i=0; i<3; i++) {
+      shared_mem->buffers[lane][i] = shm + header_size + (3 * lane + i) * slot_size;
+    }
+  }
 
   if (create) {
-    pthread_mutexattr_t mutex_attr;
-    if (0 != pthread_mutexattr_init(&mutex_attr)) {
+    if (!shm_mutex_init(&shared_mem->header->mutex)) {
       munmap(shm, shm_size);
       shm_unlink(shm_name.c_str());
+      delete shared_mem;
       return nullptr;
     }
 
-    if (0 != pthread_mutexattr_setpshared(&mutex_attr, PTHREAD_PROCESS_SHARED)) {
+    if (!shm_cond_init(&shared_mem->header->cond)) {
       munmap(shm, shm_size);
       shm_unlink(shm_name.c_str());
+      pthread_mutex_destroy(&shared_mem->header->mutex);
+      delete shared_mem;
       return nullptr;
     }
 
-    if (0 != pthread_mutex_init(&shared_mem->header->mutex, &mutex_attr)) {
-      munmap(shm, shm_size);
-      shm_unlink(shm_name.c_str());
-      return nullptr;
+    shared_mem->header->generation = 0;
+    shared_mem->header->num_lanes = num_lanes;
+    for (int lane=0; lane<num_lanes; lane++) {
+      shared_mem->header->lanes[lane].generation = 0;
+      shared_mem->header->lanes[lane].read_idx = 0;
+      shared_mem->header->lanes[lane].write_idx = 0;
     }
+    shared_mem->header->filter = ~0UL;
+  }
+
+  return shared_mem;
+}
+
+void sharedmem_destroy(SharedMem *shared_mem) {
+  if (shared_mem->owned) {
+    pthread_mutex_destroy(&shared_mem->header->mutex);
+    pthread_cond_destroy(&shared_mem->header->cond);
+  }
+
+  munmap(shared_mem->shm, shared_mem->shm_size);
+  shm_unlink(shared_mem->shm_name.c_str());
+  delete shared_mem;
+}
+
+RpcSharedMem *rpc_sharedmem_create(const std::string shm_name, const int buffer_size, const bool create) {
+  const int header_size = slot_align(sizeof(RpcSharedMemHeader));
+  const int slot_size = slot_align(buffer_size);
+  const int shm_size = header_size + 2 * slot_size;
+
+  uint8_t *shm = shm_map(shm_name, shm_size, create);
+  if (nullptr == shm) {
+    return nullptr;
+  }
+
+  RpcSharedMem *shared_mem = new RpcSharedMem;
+  shared_mem->shm_name = shm_name;
+  shared_mem->buffer_size = buffer_size;
+  shared_mem->shm = shm;
+  shared_mem->shm_size = shm_size;
+  shared_mem->owned = create;
+  shared_mem->header = (RpcSharedMemHeader*) shm;
+  shared_mem->request_buffer = shm + header_size;
+  shared_mem->reply_buffer = shm + header_size + slot_size;
 
-    pthread_condattr_t cond_attr;
-    if (0 != pthread_condattr_init(&cond_attr)) {
+  if (create) {
+    if (!shm_mutex_init(&shared_mem->header->mutex)) {
       munmap(shm, shm_size);
       shm_unlink(shm_name.c_str());
-      pthread_mutex_destroy(&shared_mem->header->mutex);
+      delete shared_mem;
       return nullptr;
     }
 
-    if (0 != pthread_condattr_setpshared(&cond_attr, PTHREAD_PROCESS_SHARED)) {
+    if (!shm_cond_init(&shared_mem->header->request_cond)) {
       munmap(shm, shm_size);
       shm_unlink(shm_name.c_str());
       pthread_mutex_destroy(&shared_mem->header->mutex);
+      delete shared_mem;
       return nullptr;
     }
 
-    if (0 != pthread_cond_init(&shared_mem->header->cond, &cond_attr)) {
+    if (!shm_cond_init(&shared_mem->header->reply_cond)) {
       munmap(shm, shm_size);
       shm_unlink(shm_name.c_str());
       pthread_mutex_destroy(&shared_mem->header->mutex);
+      pthread_cond_destroy(&shared_mem->header->request_cond);
+      delete shared_mem;
       return nullptr;
     }
 
-    shared_mem->header->generation = 0;
-    shared_mem->header->read_idx = 0;
-    shared_mem->header->write_idx = 0;
+    shared_mem->header->request_id = 0;
+    shared_mem->header->reply_id = 0;
+    shared_mem->header->request_length = 0;
+    shared_mem->header->reply_length = 0;
   }
 
   return shared_mem;
 }
 
-void sharedmem_destroy(SharedMem *shared_mem) {
+void rpc_sharedmem_destroy(RpcSharedMem *shared_mem) {
   if (shared_mem->owned) {
     pthread_mutex_destroy(&shared_mem->header->mutex);
-    pthread_cond_destroy(&shared_mem->header->cond);
+    pthread_cond_destroy(&shared_mem->header->request_cond);
+    pthread_cond_destroy(&shared_mem->header->reply_cond);
   }
 
   munmap(shared_mem->shm, shared_mem->shm_size);
   shm_unlink(shared_mem->shm_name.c_str());
+  delete shared_mem;
+}
+
+// Number of polls of the shared header before falling back to the condition variable. Spinning
+// only helps when the other side can run at the same time, so it is disabled on a single cpu.
+static const int kRpcSpinIterations = std::thread::hardware_concurrency() > 1 ? 20000 : 0;
+
+static void deadline_after(const int timeout_ms, struct timespec *deadline) {
+  clock_gettime(CLOCK_REALTIME, deadline);
+  deadline->tv_sec += timeout_ms / 1000;
+  deadline->tv_nsec += (long) (timeout_ms % 1000) * 1000000;
+  if (deadline->tv_nsec >= 1000000000) {
+    deadline->tv_sec++;
+    deadline->tv_nsec -= 1000000000;
+  }
+}
+
+static bool rpc_request_pending(RpcSharedMemHeader *header) {
+  return __atomic_load_n(&header->request_id, __ATOMIC_ACQUIRE) !=
+    __atomic_load_n(&header->reply_id, __ATOMIC_ACQUIRE);
+}
+
+static bool rpc_reply_ready(RpcSharedMemHeader *header, const unsigned long call_id) {
+  return __atomic_load_n(&header->reply_id, __ATOMIC_ACQUIRE) == call_id;
+}
+
+void rpc_sharedmem_post_request(RpcSharedMem *shared_mem, const unsigned long call_id) {
+  RpcSharedMemHeader *header = shared_mem->header;
+  pthread_mutex_lock(&header->mutex);
+  __atomic_store_n(&header->request_id, call_id, __ATOMIC_RELEASE);
+  pthread_cond_signal(&header->request_cond);
+  pthread_mutex_unlock(&header->mutex);
+}
+
+void rpc_sharedmem_post_reply(RpcSharedMem *shared_mem, const unsigned long call_id) {
+  RpcSharedMemHeader *header = shared_mem->header;
+  pthread_mutex_lock(&header->mutex);
+  __atomic_store_n(&header->reply_id, call_id, __ATOMIC_RELEASE);
+  pthread_cond_signal(&header->reply_cond);
+  pthread_mutex_unlock(&header->mutex);
+}
+
+bool rpc_sharedmem_wait_request(RpcSharedMem *shared_mem, const int timeout_ms) {
+  RpcSharedMemHeader *header = shared_mem->header;
+  for (int i=0; i<kRpcSpinIterations; i++) {
+    if (rpc_request_pending(header)) {
+      return true;
+    }
+  }
+
+  struct timespec deadline;
+  deadline_after(timeout_ms, &deadline);
+
+  pthread_mutex_lock(&header->mutex);
+  int rc = 0;
+  while (!rpc_request_pending(header) && rc == 0)
+    rc = pthread_cond_timedwait(&header->request_cond, &header->mutex, &deadline);
+  const bool pending = rpc_request_pending(header);
+  pthread_mutex_unlock(&header->mutex);
+
+  return pending;
+}
+
+bool rpc_sharedmem_wait_reply(RpcSharedMem *shared_mem, const unsigned long call_id, const int timeout_ms) {
+  RpcSharedMemHeader *header = shared_mem->header;
+  for (int i=0; i<kRpcSpinIterations; i++) {
+    if (rpc_reply_ready(header, call_id)) {
+      return true;
+    }
+  }
+
+  struct timespec deadline;
+  deadline_after(timeout_ms, &deadline);
+
+  pthread_mutex_lock(&header->mutex);
+  int rc = 0;
+  while (!rpc_reply_ready(header, call_id) && rc == 0)
+    rc = pthread_cond_timedwait(&header->reply_cond, &header->mutex, &deadline);
+  const bool ready = rpc_reply_ready(header, call_id);
+  pthread_mutex_unlock(&header->mutex);
+
+  return ready;
 }
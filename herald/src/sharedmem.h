@@ -1,35 +1,107 @@
 #pragma once
 
 #include <pthread.h>
+#include <stdint.h>
 #include <string>
 #include <sys/types.h>
 
-struct SharedMemHeader {
-  pthread_mutex_t mutex;
-  pthread_cond_t cond;
+// Message buffers are aligned to, and padded to a multiple of, a cache line.
+static const int kSlotAlignment = 64;
+
+inline int slot_align(const int size) {
+  return (size + kSlotAlignment - 1) / kSlotAlignment * kSlotAlignment;
+}
 
+// Maximum number of priority lanes in a channel, see PUB_MAX_LANES.
+static const int kMaxLanes = 4;
+
+// Triple buffer of one priority lane: the publisher writes to the slot that is neither
+// being read nor the latest written, then publishes it as write_idx.
+struct SharedMemLane {
   long generation;
   int read_idx;
   int write_idx;
 
   int lengths[3];
+
+  // Per-slot message metadata, see message_info_t.
+  unsigned long sequences[3];
+  unsigned long tags[3];
+  long publish_ns[3];
+  long write_ns[3];
+};
+
+struct SharedMemHeader {
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+
+  // Incremented with every write to any lane.
+  long generation;
+  int num_lanes;
+  SharedMemLane lanes[kMaxLanes];
+
+  // Set by the subscriber; the publisher skips messages whose tag shares no bits with it.
+  unsigned long filter;
 };
 
 struct SharedMem {
   std::string shm_name;
   int buffer_size;
+  int num_lanes;
 
-  // Shared memory fd and mmap region.
-  int shm_fd;
+  // Shared memory mmap region.
   void *shm;
   int shm_size;
   bool owned;
 
   // Pointers into shared memory region
   SharedMemHeader *header;
-  uint8_t *buffers[3];
+  uint8_t *buffers[kMaxLanes][3];
 };
 
-SharedMem *sharedmem_create(const std::string shm_name, const int buffer_size, const bool create);
+SharedMem *sharedmem_create(
+  const std::string shm_name, const int buffer_size, const int num_lanes, const bool create);
 
 void sharedmem_destroy(SharedMem *shared_mem);
+
+// Request/reply channel between a single rpc client and the rpc server. The client
+// owns the request slot and the server owns the reply slot; a call is outstanding
+// while request_id != reply_id.
+struct RpcSharedMemHeader {
+  pthread_mutex_t mutex;
+  pthread_cond_t request_cond;
+  pthread_cond_t reply_cond;
+
+  unsigned long request_id;
+  unsigned long reply_id;
+  int request_length;
+  int reply_length;
+};
+
+struct RpcSharedMem {
+  std::string shm_name;
+  int buffer_size;
+
+  // Shared memory mmap region.
+  void *shm;
+  int shm_size;
+  bool owned;
+
+  // Pointers into shared memory region
+  RpcSharedMemHeader *header;
+  uint8_t *request_buffer;
+  uint8_t *reply_buffer;
+};
+
+RpcSharedMem *rpc_sharedmem_create(const std::string shm_name, const int buffer_size, const bool create);
+
+void rpc_sharedmem_destroy(RpcSharedMem *shared_mem);
+
+// Publish a request/reply under the header mutex and wake the other side.
+void rpc_sharedmem_post_request(RpcSharedMem *shared_mem, const unsigned long call_id);
+void rpc_sharedmem_post_reply(RpcSharedMem *shared_mem, const unsigned long call_id);
+
+// Wait for an outstanding request, or for the reply to call_id. Both spin briefly before
+// blocking on the condition variable. Return false if timeout_ms elapsed first.
+bool rpc_sharedmem_wait_request(RpcSharedMem *shared_mem, const int timeout_ms);
+bool rpc_sharedmem_wait_reply(RpcSharedMem *shared_mem, const unsigned long call_id, const int timeout_ms);
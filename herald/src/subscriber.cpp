@@ -1,6 +1,5 @@
 #include <herald/subscriber.h>
 
-#include <arpa/inet.h>
 #include <atomic>
 #include <chrono>
 #include <functional>
@@ -11,19 +10,32 @@
 #include <thread>
 #include <unistd.h>
 
+#include "connection.h"
 #include "sharedmem.h"
+#include "thread_attr.h"
+#include "trace.h"
 
 struct subscriber_t {
-  subscriber_t(const int port, const callback_t callback);
+  subscriber_t(
+    const int port, const callback_t callback, const callback_ex_t callback_ex,
+    const callback_ctx_t callback_ctx, void *ctx, const subscriber_attr_t &attr);
   ~subscriber_t();
 
   subscriber_error init();
+  void set_filter(const unsigned long filter);
 
+  int pending_lane(const long *seen_generations) const;
   void thread_callback();
 
   // members
   const int _port;
   const callback_t _callback;
+  const callback_ex_t _callback_ex;
+  const callback_ctx_t _callback_ctx;
+  void *const _ctx;
+  std::atomic<unsigned long> _filter;
+  const ThreadAttr _callback_thread_attr;
+  const size_t _expected_buffer_size;
 
   int _client_fd;
   SharedMem *_shared_mem;
@@ -35,8 +47,42 @@ struct subscriber_t {
 // API functions
 // --------------------------------------------------
 
+void subscriber_attr_init(subscriber_attr_t *attr) {
+  herald_thread_attr_init(&attr->callback_thread);
+  attr->expected_buffer_size = 0;
+  attr->filter = SUB_FILTER_ALL;
+}
+
 subscriber_t *subscriber_create(const int port, const callback_t callback) {
-  return new subscriber_t(port, callback);
+  subscriber_attr_t attr;
+  subscriber_attr_init(&attr);
+  return new subscriber_t(port, callback, nullptr, nullptr, nullptr, attr);
+}
+
+subscriber_t *subscriber_create_with_attr(
+    const int port, const callback_t callback, const subscriber_attr_t *attr) {
+  subscriber_attr_t default_attr;
+  subscriber_attr_init(&default_attr);
+  return new subscriber_t(
+    port, callback, nullptr, nullptr, nullptr, attr != nullptr ? *attr : default_attr);
+}
+
+subscriber_t *subscriber_create_ex(
+    const int port, const callback_ex_t callback, const subscriber_attr_t *attr) {
+  subscriber_attr_t default_attr;
+  subscriber_attr_init(&default_attr);
+  return new subscriber_t(
+    port, nullptr, callback, nullptr, nullptr,
+    attr != nullptr ? *attr : default_attr);
+}
+
+subscriber_t *subscriber_create_ctx(
+    const int port, const callback_ctx_t callback, void *ctx, const subscriber_attr_t *attr) {
+  subscriber_attr_t default_attr;
+  subscriber_attr_init(&default_attr);
+  return new subscriber_t(
+    port, nullptr, nullptr, callback, ctx,
+    attr != nullptr ? *attr : default_attr);
 }
 
 void subscriber_destroy(subscriber_t *subscriber) {
@@ -47,14 +93,35 @@ subscriber_error subscriber_init(subscriber_t *subscriber) {
   return subscriber->init();
 }
 
+void subscriber_set_filter(subscriber_t *subscriber, const unsigned long filter) {
+  subscriber->set_filter(filter);
+}
+
+size_t subscriber_buffer_size(subscriber_t *subscriber) {
+  return subscriber->_shared_mem != nullptr ? subscriber->_shared_mem->buffer_size : 0;
+}
+
+int subscriber_num_lanes(subscriber_t *subscriber) {
+  return subscriber->_shared_mem != nullptr ? subscriber->_shared_mem->num_lanes : 0;
+}
+
 // Implementation
 // --------------------------------------------------
 
-subscriber_t::subscriber_t(const int port, const callback_t callback)
+subscriber_t::subscriber_t(
+    const int port, const callback_t callback, const callback_ex_t callback_ex,
+    const callback_ctx_t callback_ctx, void *ctx, const subscriber_attr_t &attr)
   : _port(port)
   , _callback(callback)
-  , _running(false)
-  , _client_fd(-1) {}
+  , _callback_ex(callback_ex)
+  , _callback_ctx(callback_ctx)
+  , _ctx(ctx)
+  , _filter(attr.filter)
+  , _callback_thread_attr(attr.callback_thread)
+  , _expected_buffer_size(attr.expected_buffer_size)
+  , _client_fd(-1)
+  , _shared_mem(nullptr)
+  , _running(false) {}
 
 subscriber_t::~subscriber_t() {
   if (_running) {
@@ -72,59 +139,70 @@ subscriber_t::~subscriber_t() {
 }
 
 subscriber_error subscriber_t::init() {
-  if ((_client_fd = socket(AF_INET, SOCK_STREAM, 0)) == 0) {
-    return SUB_NOSOCKET;
-  }
-
-  struct sockaddr_in address;
-  address.sin_family = AF_INET;
-  address.sin_port = htons(_port);
-
-  if (inet_pton(AF_INET, "127.0.0.1", &address.sin_addr) <= 0)  {
-    return SUB_NOSOCKET;
-  }
-
-  if (connect(_client_fd, (struct sockaddr *)&address, sizeof(address)) < 0) {
+  if ((_client_fd = connection_connect("127.0.0.1", _port)) == -1) {
     return SUB_NOSOCKET;
   }
 
-  char buffer[256];
-  int bytes_read = recv(_client_fd, buffer, 256, 0);
-  if (buffer[bytes_read-1] != '\n') {
+  ConnectionHandshake handshake;
+  if (!connection_handshake_read(_client_fd, &handshake)) {
     return SUB_BADRESP;
   }
 
-  const std::string resp(buffer, bytes_read - 1);
-  size_t sep_index = resp.find(' ');
-  if (std::string::npos == sep_index) {
+  if (_expected_buffer_size != 0 && _expected_buffer_size != (size_t) handshake.buffer_size) {
     return SUB_BADRESP;
   }
 
-  const std::string herald_id = resp.substr(0, sep_index);
-  const std::string buffer_size_str = resp.substr(sep_index + 1);
-  int buffer_size;
-
-  try {
-    buffer_size = std::stoi(buffer_size_str);
-  } catch (...) {
-    return SUB_BADRESP;
-  }
-
-  _shared_mem = sharedmem_create(herald_id, buffer_size, false);
+  _shared_mem = sharedmem_create(
+    handshake.id, handshake.buffer_size, handshake.num_lanes, false);
   if (_shared_mem == nullptr) {
     return SUB_NOSHAREDMEM;
   }
 
+  __atomic_store_n(&_shared_mem->header->filter, _filter.load(), __ATOMIC_RELEASE);
+
   _running = true;
-  _callback_thread = std::thread(std::bind(&subscriber_t::thread_callback, this));
+  if (!thread_attr_start(
+        _callback_thread, _callback_thread_attr,
+        std::bind(&subscriber_t::thread_callback, this))) {
+    _running = false;
+    close(_client_fd);
+    _client_fd = -1;
+    sharedmem_destroy(_shared_mem);
+    _shared_mem = nullptr;
+    return SUB_NOTHREADATTR;
+  }
 
   return SUB_OK;
 }
 
+void subscriber_t::set_filter(const unsigned long filter) {
+  _filter = filter;
+  if (_shared_mem != nullptr) {
+    __atomic_store_n(&_shared_mem->header->filter, filter, __ATOMIC_RELEASE);
+  }
+}
+
+// Highest lane written to since it was last read, or -1. Called with the header mutex held.
+int subscriber_t::pending_lane(const long *seen_generations) const {
+  for (int lane = _shared_mem->num_lanes - 1; lane >= 0; lane--) {
+    if (_shared_mem->header->lanes[lane].generation != seen_generations[lane]) {
+      return lane;
+    }
+  }
+  return -1;
+}
+
 void subscriber_t::thread_callback() {
   pthread_mutex_t *mutex = &_shared_mem->header->mutex;
   pthread_cond_t *cond = &_shared_mem->header->cond;
 
+  long seen_generations[kMaxLanes];
+  pthread_mutex_lock(mutex);
+  for (int lane = 0; lane < _shared_mem->num_lanes; lane++) {
+    seen_generations[lane] = _shared_mem->header->lanes[lane].generation;
+  }
+  pthread_mutex_unlock(mutex);
+
   struct timeval now;
   struct timespec timeout;
   while (_running) {
@@ -134,26 +212,44 @@ void subscriber_t::thread_callback() {
     timeout.tv_sec = now.tv_sec + 1;
     timeout.tv_nsec = now.tv_usec * 1000;
 
-    const long prev_generation = _shared_mem->header->generation;
-
+    int lane;
     int rc = 0;
-    while (prev_generation == _shared_mem->header->generation && rc == 0)
+    while ((lane = pending_lane(seen_generations)) == -1 && rc == 0)
       rc = pthread_cond_timedwait(cond, mutex, &timeout);
 
     // timeout
-    if (rc != 0) {
+    if (lane == -1) {
       pthread_mutex_unlock(mutex);
       continue;
     }
 
-    const int new_read_idx = _shared_mem->header->write_idx;
-    _shared_mem->header->read_idx = new_read_idx;
+    SharedMemLane *pending = &_shared_mem->header->lanes[lane];
+    const int new_read_idx = pending->write_idx;
+    pending->read_idx = new_read_idx;
+    seen_generations[lane] = pending->generation;
 
     pthread_mutex_unlock(mutex);
 
-    const void *buffer = _shared_mem->buffers[new_read_idx];
-    const size_t length = _shared_mem->header->lengths[new_read_idx];
+    const void *buffer = _shared_mem->buffers[lane][new_read_idx];
+    const size_t length = pending->lengths[new_read_idx];
+
+    message_info_t info;
+    info.sequence = pending->sequences[new_read_idx];
+    info.tag = pending->tags[new_read_idx];
+    info.publish_ns = pending->publish_ns[new_read_idx];
+    info.write_ns = pending->write_ns[new_read_idx];
+    info.deliver_ns = trace_now_ns();
+    info.lane = lane;
+    trace_record(TRACE_DELIVER, _port, info.lane, info.sequence, info.deliver_ns);
+
+    if (_callback_ctx != nullptr) {
+      _callback_ctx(buffer, length, &info, _ctx);
+    } else if (_callback_ex != nullptr) {
+      _callback_ex(buffer, length, &info);
+    } else {
+      _callback(buffer, length);
+    }
 
-    _callback(buffer, length);
+    trace_record(TRACE_CALLBACK_DONE, _port, info.lane, info.sequence, trace_now_ns());
   }
 }
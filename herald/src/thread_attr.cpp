@@ -0,0 +1,92 @@
+#include "thread_attr.h"
+
+#include <future>
+#include <pthread.h>
+
+static_assert(HERALD_MAX_CPUS == CPU_SETSIZE, "cpu mask size out of sync with cpu_set_t");
+
+static const int kBitsPerWord = 8 * sizeof(unsigned long);
+
+void herald_thread_attr_init(herald_thread_attr_t *attr) {
+  for (size_t word=0; word<HERALD_CPU_MASK_WORDS; word++) {
+    attr->cpu_mask[word] = 0;
+  }
+  attr->priority = 0;
+  attr->name = nullptr;
+}
+
+int herald_thread_attr_set_cpu(herald_thread_attr_t *attr, const int cpu) {
+  if (cpu < 0 || cpu >= HERALD_MAX_CPUS) {
+    return -1;
+  }
+
+  attr->cpu_mask[cpu / kBitsPerWord] |= 1UL << (cpu % kBitsPerWord);
+  return 0;
+}
+
+ThreadAttr::ThreadAttr()
+  : priority(0) {
+  CPU_ZERO(&cpu_set);
+}
+
+ThreadAttr::ThreadAttr(const herald_thread_attr_t &attr)
+  : priority(attr.priority)
+  , name(attr.name != nullptr ? attr.name : "") {
+  CPU_ZERO(&cpu_set);
+  for (int cpu=0; cpu<HERALD_MAX_CPUS; cpu++) {
+    if (attr.cpu_mask[cpu / kBitsPerWord] & (1UL << (cpu % kBitsPerWord))) {
+      CPU_SET(cpu, &cpu_set);
+    }
+  }
+}
+
+// Apply attr to the calling thread.
+static bool thread_attr_apply(const ThreadAttr &attr) {
+  const pthread_t handle = pthread_self();
+
+  if (CPU_COUNT(&attr.cpu_set) != 0) {
+    if (0 != pthread_setaffinity_np(handle, sizeof(attr.cpu_set), &attr.cpu_set)) {
+      return false;
+    }
+  }
+
+  if (attr.priority != 0) {
+    struct sched_param param;
+    param.sched_priority = attr.priority;
+    if (0 != pthread_setschedparam(handle, SCHED_FIFO, &param)) {
+      return false;
+    }
+  }
+
+  if (!attr.name.empty()) {
+    // Linux limits thread names to 16 bytes including the terminator.
+    const std::string name = attr.name.substr(0, 15);
+    if (0 != pthread_setname_np(handle, name.c_str())) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool thread_attr_start(
+    std::thread &thread, const ThreadAttr &attr, const std::function<void()> &body) {
+  std::promise<bool> applied;
+  std::future<bool> applied_future = applied.get_future();
+
+  // The thread owns the promise, so set_value never races with it going out of scope here.
+  thread = std::thread([&attr, body, applied = std::move(applied)]() mutable {
+    const bool ok = thread_attr_apply(attr);
+    applied.set_value(ok);
+    if (ok) {
+      body();
+    }
+  });
+
+  if (!applied_future.get()) {
+    thread.join();
+    return false;
+  }
+
+  return true;
+}
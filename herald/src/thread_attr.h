@@ -0,0 +1,25 @@
+#pragma once
+
+#include <herald/thread_attr.h>
+
+#include <functional>
+#include <sched.h>
+#include <string>
+#include <thread>
+
+// Owned copy of a herald_thread_attr_t, so the caller's name string need not outlive create.
+struct ThreadAttr {
+  ThreadAttr();
+  explicit ThreadAttr(const herald_thread_attr_t &attr);
+
+  // Empty leaves the affinity unchanged.
+  cpu_set_t cpu_set;
+  int priority;
+  std::string name;
+};
+
+// Start thread running body, after it has applied affinity, scheduling and name to itself,
+// so body never runs outside the configured cpus. Waits for the attributes to be applied;
+// if any of them could not be set, body is not run, thread is joined and false is returned.
+bool thread_attr_start(
+  std::thread &thread, const ThreadAttr &attr, const std::function<void()> &body);
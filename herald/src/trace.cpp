@@ -0,0 +1,134 @@
+#include "trace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <vector>
+
+// Each slot is a seqlock: version is odd while the slot is being written and
+// 2 * (index + 1) once event number index has been fully written to it.
+struct TraceSlot {
+  std::atomic<unsigned long> version;
+  std::atomic<long> timestamp_ns;
+  std::atomic<unsigned long> sequence;
+  std::atomic<int> port;
+  std::atomic<int> lane;
+  std::atomic<int> type;
+};
+
+struct TraceRing {
+  explicit TraceRing(const size_t capacity)
+    : mask(capacity - 1)
+    , head(0)
+    , slots(new TraceSlot[capacity]) {
+    for (size_t i=0; i<capacity; i++) {
+      slots[i].version = 0;
+    }
+  }
+
+  const size_t mask;
+  std::atomic<unsigned long> head;
+  TraceSlot *slots;
+};
+
+static std::atomic<TraceRing*> g_trace_ring(nullptr);
+static std::mutex g_trace_enable_mutex;
+
+int herald_trace_enable(const size_t capacity) {
+  std::unique_lock<std::mutex> lock(g_trace_enable_mutex);
+  if (g_trace_ring.load() != nullptr) {
+    return 0;
+  }
+
+  size_t rounded = 1;
+  while (rounded < capacity) rounded <<= 1;
+
+  g_trace_ring.store(new TraceRing(rounded), std::memory_order_release);
+  return 1;
+}
+
+void trace_record(
+    const herald_trace_event_type type, const int port, const int lane,
+    const unsigned long sequence, const long timestamp_ns) {
+  TraceRing *ring = g_trace_ring.load(std::memory_order_acquire);
+  if (ring == nullptr) {
+    return;
+  }
+
+  const unsigned long index = ring->head.fetch_add(1, std::memory_order_relaxed);
+  TraceSlot &slot = ring->slots[index & ring->mask];
+
+  slot.version.store(2 * index + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  slot.timestamp_ns.store(timestamp_ns, std::memory_order_relaxed);
+  slot.sequence.store(sequence, std::memory_order_relaxed);
+  slot.port.store(port, std::memory_order_relaxed);
+  slot.lane.store(lane, std::memory_order_relaxed);
+  slot.type.store(type, std::memory_order_relaxed);
+  slot.version.store(2 * (index + 1), std::memory_order_release);
+}
+
+size_t herald_trace_snapshot(herald_trace_event_t *events, const size_t max_events) {
+  TraceRing *ring = g_trace_ring.load(std::memory_order_acquire);
+  if (ring == nullptr) {
+    return 0;
+  }
+
+  const unsigned long head = ring->head.load(std::memory_order_acquire);
+  const unsigned long window = std::min((unsigned long) max_events, (unsigned long) ring->mask + 1);
+  const unsigned long first = head > window ? head - window : 0;
+
+  size_t copied = 0;
+  for (unsigned long index = first; index < head; index++) {
+    const TraceSlot &slot = ring->slots[index & ring->mask];
+
+    const unsigned long expected = 2 * (index + 1);
+    if (slot.version.load(std::memory_order_acquire) != expected) {
+      continue;
+    }
+
+    herald_trace_event_t event;
+    event.timestamp_ns = slot.timestamp_ns.load(std::memory_order_relaxed);
+    event.sequence = slot.sequence.load(std::memory_order_relaxed);
+    event.port = slot.port.load(std::memory_order_relaxed);
+    event.lane = slot.lane.load(std::memory_order_relaxed);
+    event.type = slot.type.load(std::memory_order_relaxed);
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot.version.load(std::memory_order_relaxed) != expected) {
+      continue;
+    }
+
+    events[copied++] = event;
+  }
+
+  return copied;
+}
+
+size_t herald_trace_dump(const int fd) {
+  TraceRing *ring = g_trace_ring.load(std::memory_order_acquire);
+  if (ring == nullptr) {
+    return 0;
+  }
+
+  static const char *type_names[] = {"publish", "write", "deliver", "callback_done"};
+
+  std::vector<herald_trace_event_t> events(ring->mask + 1);
+  const size_t num_events = herald_trace_snapshot(events.data(), events.size());
+
+  char line[128];
+  for (size_t i=0; i<num_events; i++) {
+    const herald_trace_event_t &event = events[i];
+    const int len = snprintf(
+      line, sizeof(line), "%ld %d %d %lu %s\n",
+      event.timestamp_ns, event.port, event.lane, event.sequence, type_names[event.type]);
+    if (write(fd, line, len) != len) {
+      return i;
+    }
+  }
+
+  return num_events;
+}
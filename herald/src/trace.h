@@ -0,0 +1,17 @@
+#pragma once
+
+#include <herald/trace.h>
+
+#include <time.h>
+
+// CLOCK_MONOTONIC time in nanoseconds, comparable across processes on the same host.
+inline long trace_now_ns() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec * 1000000000L + now.tv_nsec;
+}
+
+// Record an event if the trace ring is enabled. Lock-free and cheap when it is not.
+void trace_record(
+  const herald_trace_event_type type, const int port, const int lane,
+  const unsigned long sequence, const long timestamp_ns);
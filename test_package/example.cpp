@@ -1,10 +1,599 @@
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <cstdio>
+#include <cstring>
 #include <iostream>
+#include <pthread.h>
+#include <sched.h>
 #include <sstream>
 #include <thread>
+#include <unistd.h>
 
+#include <herald/bridge_receiver.h>
+#include <herald/bridge_sender.h>
+#include <herald/herald.hpp>
 #include <herald/publisher.h>
+#include <herald/rpc_client.h>
+#include <herald/rpc_server.h>
 #include <herald/subscriber.h>
+#include <herald/trace.h>
+
+static std::atomic<int> rpc_async_replies(0);
+static std::atomic<unsigned long> rpc_async_call_id(0);
+
+// Echoes the request, after a delay if it is "slow".
+static size_t rpc_echo(const void *request, size_t request_len, void *reply, size_t reply_capacity) {
+  if (request_len == 4 && 0 == memcmp(request, "slow", 4)) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+  }
+
+  const size_t len = std::min(request_len, reply_capacity);
+  memcpy(reply, request, len);
+  return len;
+}
+
+// A blocking call, a call that times out, which leaves the client busy until its late reply
+// arrives, and an async call.
+int rpc_loopback(const int port) {
+  rpc_server_t *server = rpc_server_create(port, 64, rpc_echo);
+  if (RPC_SERVER_OK != rpc_server_init(server)) {
+    std::cerr << "error initializing rpc server" << std::endl;
+    return -1;
+  }
+
+  rpc_client_t *client = rpc_client_create(port);
+  if (RPC_CLIENT_OK != rpc_client_init(client)) {
+    std::cerr << "error initializing rpc client" << std::endl;
+    return -1;
+  }
+
+  char reply[64];
+  size_t reply_len = 0;
+  const rpc_client_error echo_err = rpc_client_call(
+    client, "hello", 5, reply, sizeof(reply), &reply_len, 1000);
+  const bool echoed = echo_err == RPC_CLIENT_OK && reply_len == 5 && 0 == memcmp(reply, "hello", 5);
+
+  const rpc_client_error slow_err = rpc_client_call(
+    client, "slow", 4, reply, sizeof(reply), &reply_len, 50);
+  const rpc_client_error busy_err = rpc_client_call(
+    client, "hello", 5, reply, sizeof(reply), &reply_len, 50);
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+  rpc_async_replies = 0;
+  unsigned long call_id = 0;
+  const rpc_client_error async_err = rpc_client_call_async(
+    client, "async", 5, [](unsigned long id, const void *, size_t len) {
+      if (len == 5) {
+        rpc_async_call_id = id;
+        rpc_async_replies++;
+      }
+    }, &call_id);
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+  std::cout << "rpc echo " << echo_err << ", slow " << slow_err << ", busy " << busy_err
+            << ", async " << async_err << " with " << rpc_async_replies << " replies" << std::endl;
+
+  rpc_client_destroy(client);
+  rpc_server_destroy(server);
+
+  if (!echoed || slow_err != RPC_CLIENT_TIMEOUT || busy_err != RPC_CLIENT_BUSY ||
+      async_err != RPC_CLIENT_OK || rpc_async_replies != 1 || rpc_async_call_id != call_id) {
+    std::cerr << "rpc calls failed" << std::endl;
+    return -1;
+  }
+
+  return 0;
+}
+
+static const unsigned long kEvenTag = 0x1;
+static const unsigned long kOddTag = 0x2;
+
+static std::atomic<int> pinned_messages(0);
+static std::atomic<int> misplaced_messages(0);
+
+// A subscriber callback thread pinned to cpu 0 and named, and a publisher whose publish thread
+// asks for a cpu that does not exist.
+int thread_attributes(const int port) {
+  herald_thread_attr_t bad_attr;
+  herald_thread_attr_init(&bad_attr);
+  if (-1 != herald_thread_attr_set_cpu(&bad_attr, HERALD_MAX_CPUS) ||
+      -1 != herald_thread_attr_set_cpu(&bad_attr, -1)) {
+    std::cerr << "out of range cpu accepted" << std::endl;
+    return -1;
+  }
+
+  if (sysconf(_SC_NPROCESSORS_CONF) < HERALD_MAX_CPUS) {
+    publisher_attr_t missing_cpu_attr;
+    publisher_attr_init(&missing_cpu_attr);
+    herald_thread_attr_set_cpu(&missing_cpu_attr.publish_thread, HERALD_MAX_CPUS - 1);
+
+    publisher_t *publisher = publisher_create_with_attr(port, 64, &missing_cpu_attr);
+    const publisher_error err = publisher_init(publisher);
+    publisher_destroy(publisher);
+    if (err != PUB_NOTHREADATTR) {
+      std::cerr << "publisher started on a missing cpu" << std::endl;
+      return -1;
+    }
+  }
+
+  publisher_t *publisher = publisher_create_with_attr(port, 64, nullptr);
+  if (PUB_OK != publisher_init(publisher)) {
+    std::cerr << "error initializing publisher" << std::endl;
+    return -1;
+  }
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+  subscriber_attr_t attr;
+  subscriber_attr_init(&attr);
+  herald_thread_attr_set_cpu(&attr.callback_thread, 0);
+  attr.callback_thread.name = "herald-pinned";
+
+  subscriber_t *subscriber = subscriber_create_ex(
+    port, [](const void *, size_t, const message_info_t *) {
+      char name[16];
+      pthread_getname_np(pthread_self(), name, sizeof(name));
+      if (sched_getcpu() != 0 || std::string(name) != "herald-pinned") {
+        misplaced_messages++;
+      }
+      pinned_messages++;
+    }, &attr);
+
+  if (SUB_OK != subscriber_init(subscriber)) {
+    std::cerr << "error initializing pinned subscriber" << std::endl;
+    return -1;
+  }
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+  for (int i=0; i<5; i++) {
+    if (PUB_OK != publisher_publish(publisher, &i, sizeof(i))) {
+      std::cerr << "error publishing" << std::endl;
+      return -1;
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  }
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+  std::cout << "pinned " << pinned_messages << " messages, " << misplaced_messages
+            << " delivered elsewhere" << std::endl;
+
+  subscriber_destroy(subscriber);
+  publisher_destroy(publisher);
+
+  if (pinned_messages != 5 || misplaced_messages != 0) {
+    std::cerr << "callback thread attributes not applied" << std::endl;
+    return -1;
+  }
+
+  return 0;
+}
+
+static std::atomic<int> even_messages(0);
+static std::atomic<int> odd_messages(0);
+static std::atomic<int> unfiltered_messages(0);
+
+// Subscribers filtering on the even and the odd tag, and one taking everything. A message
+// published without a tag reaches all of them.
+int tag_filtering(const int port) {
+  const int num_messages = 10;
+
+  publisher_t *publisher = publisher_create(port, 64);
+  if (PUB_OK != publisher_init(publisher)) {
+    std::cerr << "error initializing tagged publisher" << std::endl;
+    return -1;
+  }
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+  subscriber_attr_t even_attr;
+  subscriber_attr_init(&even_attr);
+  even_attr.filter = kEvenTag;
+
+  subscriber_attr_t odd_attr;
+  subscriber_attr_init(&odd_attr);
+  odd_attr.filter = kOddTag;
+
+  subscriber_t *even_subscriber = subscriber_create_ex(
+    port, [](const void *, size_t, const message_info_t *) { even_messages++; }, &even_attr);
+  subscriber_t *odd_subscriber = subscriber_create_ex(
+    port, [](const void *, size_t, const message_info_t *) { odd_messages++; }, &odd_attr);
+  subscriber_t *subscriber = subscriber_create_ex(
+    port, [](const void *, size_t, const message_info_t *) { unfiltered_messages++; }, nullptr);
+
+  if (SUB_OK != subscriber_init(even_subscriber) || SUB_OK != subscriber_init(odd_subscriber) ||
+      SUB_OK != subscriber_init(subscriber)) {
+    std::cerr << "error initializing filtered subscribers" << std::endl;
+    return -1;
+  }
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+  for (int i=0; i<num_messages; i++) {
+    const unsigned long tag = (i % 2) ? kOddTag : kEvenTag;
+    if (PUB_OK != publisher_publish_tagged(publisher, &i, sizeof(i), tag)) {
+      std::cerr << "error publishing tagged message" << std::endl;
+      return -1;
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  }
+
+  const int untagged = -1;
+  if (PUB_OK != publisher_publish(publisher, &untagged, sizeof(untagged))) {
+    std::cerr << "error publishing untagged message" << std::endl;
+    return -1;
+  }
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+  std::cout << "filtered " << even_messages << " even, " << odd_messages << " odd, "
+            << unfiltered_messages << " unfiltered messages" << std::endl;
+
+  subscriber_destroy(subscriber);
+  subscriber_destroy(odd_subscriber);
+  subscriber_destroy(even_subscriber);
+  publisher_destroy(publisher);
+
+  if (even_messages != num_messages / 2 + 1 || odd_messages != num_messages / 2 + 1 ||
+      unfiltered_messages != num_messages + 1) {
+    std::cerr << "tag filtering failed" << std::endl;
+    return -1;
+  }
+
+  return 0;
+}
+
+static std::atomic<unsigned long> traced_sequence(0);
+static std::atomic<int> traced_messages(0);
+
+// With tracing enabled, a message published on port leaves a publish, write, deliver and
+// callback done event, which the text dump writes one per line.
+int trace_events(const int port) {
+  herald_trace_enable(1024);
+
+  publisher_t *publisher = publisher_create(port, 64);
+  if (PUB_OK != publisher_init(publisher)) {
+    std::cerr << "error initializing traced publisher" << std::endl;
+    return -1;
+  }
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+  subscriber_t *subscriber = subscriber_create_ex(
+    port, [](const void *, size_t, const message_info_t *info) {
+      traced_sequence = info->sequence;
+      traced_messages++;
+    }, nullptr);
+
+  if (SUB_OK != subscriber_init(subscriber)) {
+    std::cerr << "error initializing traced subscriber" << std::endl;
+    return -1;
+  }
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+  const int value = 42;
+  if (PUB_OK != publisher_publish(publisher, &value, sizeof(value))) {
+    std::cerr << "error publishing traced message" << std::endl;
+    return -1;
+  }
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+  subscriber_destroy(subscriber);
+  publisher_destroy(publisher);
+
+  static herald_trace_event_t events[1024];
+  const size_t num_events = herald_trace_snapshot(events, 1024);
+
+  bool seen[TRACE_CALLBACK_DONE + 1] = {false};
+  for (size_t i=0; i<num_events; i++) {
+    if (events[i].port == port && events[i].lane == 0 && events[i].sequence == traced_sequence &&
+        events[i].type >= TRACE_PUBLISH && events[i].type <= TRACE_CALLBACK_DONE) {
+      seen[events[i].type] = true;
+    }
+  }
+
+  FILE *dump = tmpfile();
+  if (dump == nullptr) {
+    std::cerr << "error creating trace dump file" << std::endl;
+    return -1;
+  }
+
+  const size_t num_dumped = herald_trace_dump(fileno(dump));
+  rewind(dump);
+  size_t num_lines = 0;
+  for (int c = fgetc(dump); c != EOF; c = fgetc(dump)) {
+    num_lines += c == '\n';
+  }
+  fclose(dump);
+
+  std::cout << "traced " << num_events << " events, dumped " << num_dumped << " in "
+            << num_lines << " lines" << std::endl;
+
+  if (traced_messages != 1 || !seen[TRACE_PUBLISH] || !seen[TRACE_WRITE] ||
+      !seen[TRACE_DELIVER] || !seen[TRACE_CALLBACK_DONE]) {
+    std::cerr << "trace is missing message events" << std::endl;
+    return -1;
+  }
+
+  if (num_dumped < num_events || num_lines != num_dumped) {
+    std::cerr << "trace dump is incomplete" << std::endl;
+    return -1;
+  }
+
+  return 0;
+}
+
+struct Quote {
+  int id;
+  double price;
+};
+
+// Typed messages: an aggregate emplaced in a loan and a copy published, received by a capturing
+// lambda. A subscriber of a different type is refused.
+int typed_messages(const int port) {
+  herald::Publisher<Quote> publisher(port);
+  if (PUB_OK != publisher.init()) {
+    std::cerr << "error initializing typed publisher" << std::endl;
+    return -1;
+  }
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+  std::atomic<int> received(0);
+  std::atomic<int> mismatched(0);
+  herald::Subscriber<Quote> subscriber(port, [&](const Quote &quote, const message_info_t &info) {
+    if (quote.id != (int) info.sequence || quote.price != quote.id * 0.5) {
+      mismatched++;
+    }
+    received++;
+  });
+
+  if (SUB_OK != subscriber.init()) {
+    std::cerr << "error initializing typed subscriber" << std::endl;
+    return -1;
+  }
+
+  herald::Subscriber<int> wrong_subscriber(port, [](const int&) {});
+  const subscriber_error wrong_err = wrong_subscriber.init();
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+  for (int i=0; i<10; i++) {
+    const publisher_error err = (i % 2) ? publisher.publish(Quote{i, i * 0.5})
+                                        : publisher.emplace(i, i * 0.5);
+    if (PUB_OK != err) {
+      std::cerr << "error publishing typed message" << std::endl;
+      return -1;
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  }
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+  std::cout << "received " << received << " typed messages, " << mismatched << " mismatched"
+            << std::endl;
+
+  if (received != 10 || mismatched != 0 || wrong_err != SUB_BADRESP) {
+    std::cerr << "typed messages failed" << std::endl;
+    return -1;
+  }
+
+  return 0;
+}
+
+static std::atomic<int> flat_messages(0);
+static std::atomic<int> misread_flat_messages(0);
+
+// Flat messages built in publisher loans with a string, a vector, a nested table and a
+// missing field, read back with flat::root. One too large for the buffer is refused.
+int flat_messages_roundtrip(const int port) {
+  publisher_t *publisher = publisher_create(port, 256);
+  if (PUB_OK != publisher_init(publisher)) {
+    std::cerr << "error initializing flat publisher" << std::endl;
+    return -1;
+  }
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+  subscriber_t *subscriber = subscriber_create_ex(
+    port, [](const void *msg, size_t, const message_info_t *) {
+      const herald::flat::Table order = herald::flat::root(msg);
+      const int id = order.get<int>(0, -1);
+      const herald::flat::Vector<double> prices = order.get_vector<double>(2);
+      const herald::flat::Table venue = order.get_table(3);
+
+      if (order.get_string(1).str() != "order " + std::to_string(id) || prices.size() != 3 ||
+          prices[2] != id * 1.5 || venue.get<uint8_t>(0, 0) != 7 || order.has(4) ||
+          order.get<int>(4, 99) != 99) {
+        misread_flat_messages++;
+      }
+      flat_messages++;
+    }, nullptr);
+
+  if (SUB_OK != subscriber_init(subscriber)) {
+    std::cerr << "error initializing flat subscriber" << std::endl;
+    return -1;
+  }
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+  for (int i=0; i<5; i++) {
+    herald::flat::LoanBuilder builder(publisher);
+    const herald::flat::Ref name = builder.create_string("order " + std::to_string(i));
+    const double prices[] = {i * 0.5, i * 1.0, i * 1.5};
+    const herald::flat::Ref price_vector = builder.create_vector(prices, 3);
+
+    builder.start_table(1);
+    builder.add<uint8_t>(0, 7);
+    const herald::flat::Ref venue = builder.end_table();
+
+    builder.start_table(5);
+    builder.add<int>(0, i);
+    builder.add(1, name);
+    builder.add(2, price_vector);
+    builder.add(3, venue);
+    const herald::flat::Ref order = builder.end_table();
+
+    if (PUB_OK != builder.publish(order)) {
+      std::cerr << "error publishing flat message" << std::endl;
+      return -1;
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  }
+
+  publisher_error large_err;
+  {
+    // Scoped so the unpublished loan is given back before the publisher is destroyed.
+    herald::flat::LoanBuilder large_builder(publisher);
+    const herald::flat::Ref large_name = large_builder.create_string(std::string(300, 'x'));
+    large_builder.start_table(2);
+    large_builder.add(1, large_name);
+    large_err = large_builder.publish(large_builder.end_table());
+  }
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+  std::cout << "read " << flat_messages << " flat messages, " << misread_flat_messages
+            << " misread" << std::endl;
+
+  subscriber_destroy(subscriber);
+  publisher_destroy(publisher);
+
+  if (flat_messages != 5 || misread_flat_messages != 0 || large_err != PUB_TOOLARGE) {
+    std::cerr << "flat messages failed" << std::endl;
+    return -1;
+  }
+
+  return 0;
+}
+
+static std::atomic<int> bridged_messages[PUB_MAX_LANES];
+static std::atomic<int> filtered_messages(0);
+static std::atomic<int> misfiltered_messages(0);
+
+// publisher -> bridge sender -> tcp loopback -> bridge receiver -> subscribers, publishing one
+// message on each of num_lanes lanes per round, tagged by whether the round is odd. One remote
+// subscriber takes everything, the other filters on the odd tag.
+int bridge_loopback(const int port, const int num_lanes) {
+  const int num_rounds = 20;
+  const int num_messages = num_rounds * num_lanes;
+
+  for (int lane=0; lane<PUB_MAX_LANES; lane++) {
+    bridged_messages[lane] = 0;
+  }
+  filtered_messages = 0;
+  misfiltered_messages = 0;
+
+  publisher_attr_t attr;
+  publisher_attr_init(&attr);
+  attr.num_lanes = num_lanes;
+
+  publisher_t *publisher = publisher_create_with_attr(port, 64, &attr);
+  if (PUB_OK != publisher_init(publisher)) {
+    std::cerr << "error initializing bridged publisher" << std::endl;
+    return -1;
+  }
+
+  bridge_sender_t *sender = bridge_sender_create(port, port + 1, 4096);
+  if (BRIDGE_SENDER_OK != bridge_sender_init(sender)) {
+    std::cerr << "error initializing bridge sender" << std::endl;
+    return -1;
+  }
+
+  bridge_receiver_t *receiver = bridge_receiver_create("127.0.0.1", port + 1, port + 2);
+  if (BRIDGE_RECEIVER_OK != bridge_receiver_init(receiver)) {
+    std::cerr << "error initializing bridge receiver" << std::endl;
+    return -1;
+  }
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+  subscriber_t *subscriber = subscriber_create_ex(
+    port + 2, [](const void *, size_t, const message_info_t *info) {
+      bridged_messages[info->lane]++;
+    }, nullptr);
+
+  if (SUB_OK != subscriber_init(subscriber)) {
+    std::cerr << "error initializing bridged subscriber" << std::endl;
+    return -1;
+  }
+
+  subscriber_attr_t filtered_attr;
+  subscriber_attr_init(&filtered_attr);
+  filtered_attr.filter = kOddTag;
+
+  subscriber_t *filtered_subscriber = subscriber_create_ex(
+    port + 2, [](const void *, size_t, const message_info_t *info) {
+      filtered_messages++;
+      if (info->tag != kOddTag) {
+        misfiltered_messages++;
+      }
+    }, &filtered_attr);
+
+  if (SUB_OK != subscriber_init(filtered_subscriber)) {
+    std::cerr << "error initializing filtered bridged subscriber" << std::endl;
+    return -1;
+  }
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+  for (int i=0; i<num_rounds; i++) {
+    for (int lane=0; lane<num_lanes; lane++) {
+      const unsigned long tag = (i % 2) ? kOddTag : kEvenTag;
+      if (PUB_OK != publisher_publish_lane(publisher, &i, sizeof(i), tag, lane)) {
+        std::cerr << "error publishing to bridge" << std::endl;
+        return -1;
+      }
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  }
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+  bridge_receiver_stats_t stats;
+  bridge_receiver_get_stats(receiver, &stats);
+
+  int delivered = 0;
+  bool lanes_complete = true;
+  for (int lane=0; lane<num_lanes; lane++) {
+    delivered += bridged_messages[lane];
+    lanes_complete = lanes_complete && bridged_messages[lane] == num_rounds;
+  }
+
+  std::cout << "bridged " << delivered << "/" << num_messages << " messages on " << num_lanes
+            << " lanes, " << stats.gaps << " gaps, " << stats.lost << " lost, "
+            << stats.resyncs << " resyncs, " << filtered_messages << " filtered" << std::endl;
+
+  subscriber_destroy(filtered_subscriber);
+  subscriber_destroy(subscriber);
+  bridge_receiver_destroy(receiver);
+  bridge_sender_destroy(sender);
+  publisher_destroy(publisher);
+
+  if (!lanes_complete || stats.messages != (unsigned long) num_messages ||
+      stats.gaps != 0 || stats.lost != 0 || stats.resyncs != 0 || !stats.connected) {
+    std::cerr << "bridge lost messages" << std::endl;
+    return -1;
+  }
+
+  if (filtered_messages != num_messages / 2 || misfiltered_messages != 0) {
+    std::cerr << "bridge did not preserve message tags" << std::endl;
+    return -1;
+  }
+
+  return 0;
+}
 
 int main() {
   publisher_t *publisher = publisher_create(8080, 1024);
@@ -41,4 +630,34 @@ int main() {
 
   subscriber_destroy(subscriber);
   publisher_destroy(publisher);
+
+  if (0 != rpc_loopback(8087)) {
+    return -1;
+  }
+
+  if (0 != thread_attributes(8089)) {
+    return -1;
+  }
+
+  if (0 != tag_filtering(8088)) {
+    return -1;
+  }
+
+  if (0 != trace_events(8090)) {
+    return -1;
+  }
+
+  if (0 != typed_messages(8091)) {
+    return -1;
+  }
+
+  if (0 != flat_messages_roundtrip(8092)) {
+    return -1;
+  }
+
+  if (0 != bridge_loopback(8081, 1)) {
+    return -1;
+  }
+
+  return bridge_loopback(8084, 2);
 }